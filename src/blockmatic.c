@@ -27,223 +27,188 @@
 #include "tetri.h"
 #include "param.h"
 #include "engine.h"
+#include "game.h"
 #include "grid.h"
+#include "headless.h"
+#include "input.h"
+#include "capture.h"
+#include "debug.h"
 
-int main(int argc, char **argv) {
-
-	const Settings* settings = start_engine(argc, argv);
-	if(settings->leave) {
-		return EXIT_FAILURE;
-	}
-	atexit(stop_engine);
-
-	// needed to control the framerate
-	uint32_t last_time_refresh = get_ms(), current_time;
-	uint32_t delay_until_refresh = 1000 / GAME_FRAMERATE;
-
-	// wait settings->duration ms before moving down, this number will decrease
-	uint32_t last_time_movedown = last_time_refresh;
-	uint32_t delay_until_movedown = (uint32_t)settings->duration;
+/*
+ * the maximum number of ms of game time stepped in a single frame
+ */
+#define MAX_CATCHUP_MS 250
 
-	// wait settings->delay ms before decreasing delay, if settings->usedelay
-	uint32_t last_time_decrease = last_time_refresh;
-	uint32_t delay_until_decrease = (uint32_t)settings->delay;
+/*
+ * the inputs of a game step without any input
+ */
+static const bool s_no_inputs[__LAST_EVENT] = { false };
 
-	// if keypause, the game was paused because P was pressed
-	bool pause = false, keypause = false;
 
-	// if recycle / movedown, require a new tetrimino / move down current tetrimino, etc.
-	bool recycle = false, movedown = false, newgame = true;
+/*
+ * step game at time with inputs, then let auto-shift know if a new tetri appeared
+ */
+static void step_game(GameState *game, const bool *inputs, uint32_t time) {
+	int tetriminos = game->tetriminos, games = game->games;
 
-	// the number of completed rows and the level
-	int completed_rows = 0, level = 1, level_rows = 0;
+	game_step(game, inputs, time);
 
+	if(!game->over && (game->tetriminos != tetriminos || game->games != games)) {
+		shift_new_tetri(time);
+	}
+}
 
-	Tetri next = new_random_tetri(settings), tetri = new_random_tetri(settings);
-	while(!settings->leave) {
-		current_time = get_ms();
 
-		if(current_time - last_time_movedown >= delay_until_movedown) {
-			last_time_movedown = current_time;
-			movedown = true;
+/*
+ * handle the inputs of queue which happened no later than time until, in order, each one in its own game step at its own time
+ * step_time is the time of the last game step, which cannot go back
+ * return the number of inputs handled
+ */
+static int handle_inputs(GameState *game, InputQueue *queue, uint32_t until, uint32_t *step_time) {
+	assert(game != NULL);
+	assert(queue != NULL);
+	assert(step_time != NULL);
+
+	// a single input per game step, so that none of them is merged with another one
+	bool inputs[__LAST_EVENT] = { false };
+	int handled = 0;
+
+	Input input;
+	while(!game->over && peek_input(queue, &input) && input.time <= until) {
+		pop_input(queue, &input);
+		handled++;
+
+		if(input.event == EXIT_EVENT) {
+			trigger_exit();
+			break;
 		}
 
-		if(current_time >= (last_time_refresh + delay_until_refresh)) {
-			last_time_refresh = current_time;
+		if(input.time > *step_time) {
+			*step_time = input.time;
+		}
 
-			// care about events
-			const bool* events = receive_events();
-			if(events[EXIT_EVENT]) {
-				trigger_exit();
-				continue;
-			}
+		inputs[input.event] = true;
+		step_game(game, inputs, *step_time);
+		inputs[input.event] = false;
 
-			if(events[PAUSE_EVENT]) {
-				pause = !pause;
-				keypause = !keypause;
-			}
+		track_input(input.time);
+	}
 
-			if(events[FOCUSLOST_EVENT]) {
-				pause = true;
-			}
+	return handled;
+}
 
-			if(events[FOCUSGAINED_EVENT] && !keypause) {
-				pause = false;
-			}
 
-			if(events[NEWGAME_EVENT]) {
-				newgame = true;
-			}
+int main(int argc, char **argv) {
 
-			if(!pause && !movedown && !newgame) {
-				if(events[LEFT_EVENT]) {
-					move_tetri(&tetri, LEFT_MOVE);
-				}
+	const Settings* settings = start_engine(argc, argv);
+	if(settings->leave) {
+		return EXIT_FAILURE;
+	}
+	atexit(stop_engine);
 
-				if(events[RIGHT_EVENT]) {
-					move_tetri(&tetri, RIGHT_MOVE);
-				}
+	if(settings->headless > 0) {
+		return run_headless(settings);
+	}
 
-				if(events[DELETE_EVENT]) {
-					if(!empty_row(settings->blocks_per_col - 1)) {
-						shift_grid(settings->blocks_per_col-1);
-						completed_rows++;
-					}
-				}
+	if(settings->capture != NULL) {
+		return run_capture(settings);
+	}
 
-				if(events[DROP_EVENT]) {
-					while(move_tetri(&tetri, DOWN_MOVE));
-					recycle = true;
-				}
+	/*
+	 * the game is stepped settings->tickrate times per second whatever the framerate,
+	 * so that slow frames don't change the game timing
+	 * game_us is the time the game has been stepped to
+	 */
+	uint64_t tick_us = 1000000 / (uint64_t) settings->tickrate;
+	uint64_t game_us = get_us();
 
-				if(events[ROTATE_CLOCKWS_EVENT]) {
-					rotate_tetri(&tetri, CLOCKWISE_ROTATION, settings);
-				}
+	GameState *game = create_game(settings, (uint32_t) (game_us / 1000));
+	if(!game) {
+		return EXIT_FAILURE;
+	}
 
-				if(events[ROTATE_COUNTERCLOCKWS_EVENT]) {
-					rotate_tetri(&tetri, COUNTERCLOCKWISE_ROTATION, settings);
-				}
+	uint32_t step_time = (uint32_t) (game_us / 1000);
 
-				if(events[SHIFT_EVENT]) {
-					if(!move_tetri(&tetri, DOWN_MOVE)) {
-						recycle = true;
-					}
-				}
-			} else if(!pause && !newgame) {
-				if(!move_tetri(&tetri, DOWN_MOVE)) {
-					recycle = true;
-				}
+	while(!settings->leave) {
+		// care about events
+		InputQueue *queue = receive_events();
 
-				movedown = false;
-			}
+		uint64_t now_us = get_us();
 
-			// detect complete rows
-			if(!pause && !newgame) {
-				int complete;
-				while((complete = complete_line()) != -1) {
-					shift_grid(complete);
-					completed_rows++;
-				}
-			}
+		/*
+		 * after a long stall (the window being moved, for example), the game doesn't rush to catch up
+		 * the skipped time is hidden from the game too, otherwise gravity would make up for all of it at once
+		 */
+		if(now_us - game_us > MAX_CATCHUP_MS * 1000) {
+			uint32_t skipped = (uint32_t) ((now_us - MAX_CATCHUP_MS * 1000) / 1000 - game_us / 1000);
 
-			// recycle?
-			if(recycle) {
-				freeze_tetri(&tetri);
-				tetri = next;
-				next = new_random_tetri(settings);
-
-				if(!valid_position(&tetri)) {
-					if(settings->restart) {
-						newgame = true;
-					} else {
-						trigger_exit();
-						continue;
-					}
-				}
+			skip_game_time(game, skipped);
+			step_time += skipped;
 
-				last_time_movedown = current_time;
+			game_us = now_us - MAX_CATCHUP_MS * 1000;
+		}
 
-				recycle = false;
-			}
+		while(game_us + tick_us <= now_us && !game->over && !settings->leave) {
+			game_us += tick_us;
 
-			// new game?
-			if(newgame) {
-				tetri = new_random_tetri(settings);
-				next = new_random_tetri(settings);
-				erase_grid();
+			// the inputs which happened before this step are handled first
+			handle_inputs(game, queue, (uint32_t) (game_us / 1000), &step_time);
 
-				int start_row = settings->blocks_per_col - settings->rows;
-				for(int row = start_row; row < settings->blocks_per_col; row++) {
-					fill_row(row);
+			// late inputs may have been handled ahead of this step
+			if(!game->over && !settings->leave) {
+				if(game_us / 1000 > step_time) {
+					step_time = (uint32_t) (game_us / 1000);
 				}
 
-				last_time_movedown = current_time;
-				delay_until_movedown = (uint32_t)settings->duration;
-				completed_rows = 0;
-				level = 1;
-
-				newgame = false;
-				pause = false;
+				step_game(game, s_no_inputs, step_time);
 			}
+		}
 
-			// next level?
-			if(settings->usedelay && !pause) {
-				if(current_time - last_time_decrease >= (delay_until_decrease * 1000)) {
-					level++;
-
-					uint32_t drawback = (delay_until_movedown / 100) * (uint32_t)settings->decrease;
-					delay_until_movedown -= drawback;
-
-					last_time_decrease = current_time;
-					last_time_movedown = current_time;
-				}
-			} else {
-				if(completed_rows >= settings->threshold + level_rows) {
-					level_rows += settings->threshold;
-					level++;
-
-					uint32_t drawback = (delay_until_movedown / 100) * (uint32_t)settings->decrease;
-					delay_until_movedown -= drawback;
+		if(settings->leave) {
+			continue;
+		}
 
-					last_time_movedown = current_time;
-				}
-			}
+		if(game->over) {
+			trigger_exit();
+			continue;
+		}
 
-			// care about drawing
-			clear_screen();
+		// late inputs may have stepped the game past game_us, it cannot be drawn before its last step
+		uint32_t draw_time = (uint32_t) (game_us / 1000);
+		if(step_time > draw_time) {
+			draw_time = step_time;
+		}
 
-			draw_tetri(&tetri, 255);
-			draw_grid();
+		draw_game(game, draw_time);
 
-			// hints about the tetri position when fallen
-			if(settings->foresee_fallen && !pause) {
-				Tetri fallen = find_fallen_position(&tetri);
-				draw_tetri(&fallen, settings->fallen_opacity);
-			}
+		if(settings->late_latch) {
+			// the frame scheduler keeps the framerate, the inputs received meanwhile go into this frame
+			wait_frame();
 
-			if(pause) {
-				draw_pause();
-			} else {
-				if(settings->preview) {
-					draw_preview(&next);
+			queue = receive_events();
+			if(handle_inputs(game, queue, (uint32_t) (get_us() / 1000), &step_time) > 0) {
+				if(settings->leave) {
+					continue;
 				}
 
-				draw_statistics(level, completed_rows);
-
-				if(settings->hints) {
-					// compute percentage
-					int incomplete_delay = (int)(current_time - last_time_movedown);
-					int percentage = (incomplete_delay * 100) / (int)delay_until_movedown;
-
-					draw_percentage(percentage);
+				if(game->over) {
+					trigger_exit();
+					continue;
 				}
+
+				redraw_tetri(game, step_time);
 			}
 
 			update_screen();
 		} else {
-			pause_engine((last_time_refresh + delay_until_refresh) - current_time);
+			update_screen();
+
+			// the frame scheduler keeps the framerate
+			wait_frame();
 		}
 	}
 
+	destroy_game(game);
+
 	return EXIT_SUCCESS;
 }
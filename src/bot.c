@@ -0,0 +1,132 @@
+
+/*
+ * bot.c
+ *
+ * Copyright 2012 Bresson Matthieu <mbresson@etudiant.univ-mlv.fr>
+ *
+ * This file is part of Blockmatic.
+ *
+ * Blockmatic is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Blockmatic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULIAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Blockmatic. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bot.h"
+
+#include "debug.h"
+
+#include <stddef.h>
+
+
+static inline int count_bits(Row row) {
+	int count = 0;
+
+	for(; row != 0; row &= row - 1) {
+		count++;
+	}
+
+	return count;
+}
+
+
+/*
+ * rate a grid once the tetri has been frozen and the complete lines deleted,
+ * the higher the better
+ * the weights come from a well-known hand-tuned evaluation function:
+ * keep the stack low, flat and without holes, complete lines
+ */
+static double rate_grid(const Grid *grid, int lines) {
+	int blocks_per_col, blocks_per_row;
+	get_grid_size(grid, &blocks_per_col, &blocks_per_row);
+
+	const Row *rows = get_rows(grid);
+	const int *heights = get_heights(grid);
+
+	int total_height = 0, bumpiness = 0, holes = 0;
+
+	for(int x = 0; x < blocks_per_row; x++) {
+		total_height += blocks_per_col - heights[x];
+
+		if(x > 0) {
+			int step = heights[x] - heights[x - 1];
+			bumpiness += step < 0 ? -step : step;
+		}
+	}
+
+	// a hole is an empty case below a filled one
+	Row covered = 0;
+	for(int y = 0; y < blocks_per_col; y++) {
+		holes += count_bits(covered & ~rows[y]);
+		covered |= rows[y];
+	}
+
+	return -0.51 * total_height + 0.76 * lines - 0.36 * holes - 0.18 * bumpiness;
+}
+
+
+/*
+ * every orientation is tried in every column where it fits at the current row,
+ * then dropped straight down
+ */
+bool choose_placement(const Grid *grid, Grid *scratch, const Tetri *tetri, Tetri *target) {
+	assert(grid != NULL);
+	assert(scratch != NULL);
+	assert(tetri != NULL);
+	assert(target != NULL);
+
+	int blocks_per_col, blocks_per_row;
+	get_grid_size(grid, &blocks_per_col, &blocks_per_row);
+
+	bool found = false;
+	double best = 0;
+
+	for(int orientation = TOP_ORIENTED; orientation < __LAST_ORIENTED; orientation++) {
+		Tetri candidate = *tetri;
+		candidate.orientation = (Orientation) orientation;
+		candidate.shape = get_shape(candidate.type, candidate.orientation);
+
+		// some orientations are taller than others and wouldn't fit at the top row
+		if(candidate.py < candidate.shape->py) {
+			candidate.py = candidate.shape->py;
+		}
+
+		// the O tetri looks the same in every orientation
+		if(orientation > TOP_ORIENTED && candidate.type == O_FORMAT) {
+			break;
+		}
+
+		for(int px = 0; px < blocks_per_row; px++) {
+			candidate.px = px;
+
+			if(!valid_position(grid, &candidate)) {
+				continue;
+			}
+
+			copy_grid(scratch, grid);
+
+			Tetri fallen = find_fallen_position(scratch, &candidate);
+			freeze_tetri(scratch, &fallen);
+
+			int lines[MAX_CLEARED_LINES];
+			double rate = rate_grid(scratch, clear_lines(scratch, lines));
+
+			if(!found || rate > best) {
+				found = true;
+				best = rate;
+				*target = candidate;
+			}
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,17 @@
+
+#ifndef H_BOT
+#define H_BOT
+
+#include "grid.h"
+#include "tetri.h"
+
+/*
+ * find where tetri should be dropped in grid:
+ * target gets the best orientation and column found,
+ * at the current row of tetri or a bit lower if the orientation requires it
+ * scratch is a grid of the same size, used to try each position
+ * return false if tetri doesn't fit anywhere
+ */
+bool choose_placement(const Grid *grid, Grid *scratch, const Tetri *tetri, Tetri *target);
+
+#endif
@@ -0,0 +1,238 @@
+
+/*
+ * capture.c
+ *
+ * Copyright 2012 Bresson Matthieu <mbresson@etudiant.univ-mlv.fr>
+ *
+ * This file is part of Blockmatic.
+ *
+ * Blockmatic is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Blockmatic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULIAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Blockmatic. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "capture.h"
+
+#include "engine.h"
+#include "game.h"
+#include "input.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * the number of frames drawn to time each drawing function
+ */
+#define TIMED_FRAMES 100
+
+/*
+ * with an uncapped framerate, the game is stepped once per ms of virtual time
+ */
+#define UNCAPPED_FRAMERATE 1000
+
+/*
+ * the maximum length of a line of the script
+ */
+#define MAX_LINE_LENGTH 256
+
+typedef enum {
+	CLEAR_DRAWING,
+	GRID_DRAWING,
+	TETRI_DRAWING,
+	PREVIEW_DRAWING,
+	PAUSE_DRAWING,
+	PERCENTAGE_DRAWING,
+	STATISTICS_DRAWING,
+	__LAST_DRAWING
+} Drawing;
+
+static const char *s_drawings[__LAST_DRAWING] = {
+	"clear_screen + update_screen",
+	"draw_grid",
+	"draw_tetri",
+	"draw_preview",
+	"draw_pause",
+	"draw_percentage",
+	"draw_statistics"
+};
+
+
+/*
+ * draw TIMED_FRAMES frames with drawing between clear_screen and update_screen
+ * return the number of microseconds per frame
+ */
+static double time_drawing(const GameState *game, Drawing drawing) {
+	assert(game != NULL);
+
+	Tetri tetri = game->tetri, next = game->next;
+
+	uint64_t start = get_us();
+
+	for(int frame = 0; frame < TIMED_FRAMES; frame++) {
+		clear_screen();
+
+		switch(drawing) {
+		case GRID_DRAWING:
+			draw_grid(game->grid);
+			break;
+
+		case TETRI_DRAWING:
+			draw_tetri(&tetri, 255);
+			break;
+
+		case PREVIEW_DRAWING:
+			draw_preview(&next);
+			break;
+
+		case PAUSE_DRAWING:
+			draw_pause();
+			break;
+
+		case PERCENTAGE_DRAWING:
+			draw_percentage(50);
+			break;
+
+		case STATISTICS_DRAWING:
+			draw_statistics(game->level, game->completed_rows);
+			break;
+
+		default:
+			break;
+		}
+
+		update_screen();
+	}
+
+	return (double) (get_us() - start) / TIMED_FRAMES;
+}
+
+
+int run_capture(const Settings *settings) {
+	assert(settings != NULL);
+	assert(settings->capture != NULL);
+
+	FILE *script = fopen(settings->capture, "r");
+	if(!script) {
+		fprintf(stderr, "Couldn't open '%s'!\n", settings->capture);
+		return EXIT_FAILURE;
+	}
+
+	// virtual time, in milliseconds, and in microseconds so that frames aren't rounded
+	uint32_t now = 0;
+	uint64_t now_us = 0;
+	uint64_t frame_us = 1000000 / (uint64_t) (settings->framerate > 0 ? settings->framerate : UNCAPPED_FRAMERATE);
+
+	GameState *game = create_game(settings, now);
+	if(!game) {
+		fclose(script);
+		return EXIT_FAILURE;
+	}
+
+	bool inputs[__LAST_EVENT] = { false };
+
+	// the first step starts the game
+	game_step(game, inputs, now);
+
+	int status = EXIT_SUCCESS, captures = 0;
+
+	char line[MAX_LINE_LENGTH];
+	for(int number = 1; status == EXIT_SUCCESS && !game->over && fgets(line, sizeof(line), script) != NULL; number++) {
+		char *word = strtok(line, " \t\r\n");
+
+		// empty line or comment
+		if(word == NULL || word[0] == '#') {
+			continue;
+		}
+
+		if(strcmp(word, "wait") == 0) {
+			char *end = NULL, *value = strtok(NULL, " \t\r\n");
+			long ms = value != NULL ? strtol(value, &end, 10) : -1;
+
+			if(ms < 0 || *end != '\0' || strtok(NULL, " \t\r\n") != NULL) {
+				fprintf(stderr, "'%s', line %d: 'wait' expects a number of ms!\n", settings->capture, number);
+				status = EXIT_FAILURE;
+				continue;
+			}
+
+			// one step per frame, as if the game was really played
+			for(uint64_t until = now_us + (uint64_t) ms * 1000; now_us < until && !game->over; ) {
+				now_us += frame_us;
+				if(now_us > until) {
+					now_us = until;
+				}
+
+				now = (uint32_t) (now_us / 1000);
+				game_step(game, inputs, now);
+			}
+
+		} else if(strcmp(word, "capture") == 0) {
+			char *filename = strtok(NULL, " \t\r\n");
+
+			if(filename == NULL || strtok(NULL, " \t\r\n") != NULL) {
+				fprintf(stderr, "'%s', line %d: 'capture' expects a file name!\n", settings->capture, number);
+				status = EXIT_FAILURE;
+				continue;
+			}
+
+			draw_game(game, now);
+			update_screen();
+			if(!capture_screen(filename)) {
+				status = EXIT_FAILURE;
+			} else {
+				captures++;
+			}
+
+		} else { // a single step with every input of the line
+			for(; word != NULL && status == EXIT_SUCCESS; word = strtok(NULL, " \t\r\n")) {
+				// leaving is up to the script's end
+				Event input = find_event(word);
+				if(input == __LAST_EVENT || input == EXIT_EVENT) {
+					fprintf(stderr, "'%s', line %d: unknown input '%s'!\n", settings->capture, number, word);
+					status = EXIT_FAILURE;
+				} else {
+					inputs[input] = true;
+				}
+			}
+
+			if(status == EXIT_SUCCESS) {
+				game_step(game, inputs, now);
+			}
+
+			memset(inputs, false, sizeof(inputs));
+		}
+	}
+
+	fclose(script);
+
+	if(status == EXIT_SUCCESS) {
+		printf("frames captured: %d\n", captures);
+
+		/*
+		 * time each drawing function in isolation, on the last state of the game
+		 * clear_screen and update_screen are needed by every frame, so their time is subtracted from the others
+		 */
+
+		double baseline = time_drawing(game, CLEAR_DRAWING);
+		printf("%s: %.1f us per frame\n", s_drawings[CLEAR_DRAWING], baseline);
+
+		for(int drawing = CLEAR_DRAWING + 1; drawing < __LAST_DRAWING; drawing++) {
+			printf("%s: %.1f us per frame\n", s_drawings[drawing], time_drawing(game, drawing) - baseline);
+		}
+	}
+
+	destroy_game(game);
+
+	return status;
+}
@@ -0,0 +1,15 @@
+
+#ifndef H_CAPTURE
+#define H_CAPTURE
+
+#include "param.h"
+
+/*
+ * play the script settings->capture in a hidden window, saving the frames it asks for
+ * then print the number of microseconds each drawing function takes per frame
+ * time is virtual: the script gives the same frames every time a seed is set
+ * return EXIT_SUCCESS, or EXIT_FAILURE if the script is invalid or a frame couldn't be saved
+ */
+int run_capture(const Settings *settings);
+
+#endif
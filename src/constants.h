@@ -5,7 +5,9 @@
 #define GAME_TITLE "Blockmatic"
 #define GAME_VERSION "0.5"
 #define GAME_CREATOR "Bresson Matthieu"
-#define GAME_FRAMERATE 60
+
+// each row of the grid is stored as a 64-bit mask (see grid.h)
+#define MAX_BLOCKS_PER_ROW 64
 
 #define CHEATMODE_STRING "42"
 
@@ -4,6 +4,10 @@
 
 #include "paths.h"
 
+#define DEFAULT_ARR 50 // ms
+
+#define DEFAULT_BACKEND SDL_BACKEND
+
 #define DEFAULT_BACKGROUND_FILE NULL
 #define DEFAULT_BACKGROUND_CENTER false
 #define DEFAULT_BACKGROUND_CROP false
@@ -17,8 +21,12 @@
 #define DEFAULT_BLOCKS_PER_COL 20
 #define DEFAULT_BLOCKS_PER_ROW 14
 
+#define DEFAULT_CAPTURE NULL
+
+#define DEFAULT_DAS 170 // ms
 #define DEFAULT_DECREASE 10 // %
 #define DEFAULT_DELAY 60 // seconds
+#define DEFAULT_DIRTY_RECTS false
 #define DEFAULT_DURATION 2000 // ms
 
 #define DEFAULT_FONT_FILE FONT_PREFIX "Cantarell-Bold.otf"
@@ -28,10 +36,21 @@
 #define DEFAULT_FONT_GREEN 255
 #define DEFAULT_FONT_BLUE 255
 
+#define DEFAULT_FRAMERATE 60 // frames per second
+#define DEFAULT_FRAME_STATS false
+
+#define DEFAULT_HEADLESS 0
+
 #define DEFAULT_HINTS true
 
+#define DEFAULT_INJECT 0
+
+#define DEFAULT_KEYMAP NULL
 #define DEFAULT_KEYREPEAT true
 
+#define DEFAULT_LATE_LATCH false
+#define DEFAULT_LATENCY_REPORT false
+
 #define DEFAULT_PAUSE_MESSAGE "PAUSE"
 
 #define DEFAULT_PAUSE_RED 100
@@ -40,6 +59,8 @@
 
 #define DEFAULT_PREVIEW true
 
+#define DEFAULT_RANDOMIZER UNIFORM_RANDOMIZER
+
 #define DEFAULT_RESTART false
 
 #define DEFAULT_ROWS 0
@@ -50,8 +71,12 @@
 #define DEFAULT_THRESHOLD 10
 #define DEFAULT_USEDELAY false
 
+#define DEFAULT_TICKRATE 1000 // game steps per second
+
 #define DEFAULT_VI_MODE false
 
+#define DEFAULT_VSYNC false
+
 #define DEFAULT_WINDOW_ICON IMG_PREFIX "icon.png"
 #define DEFAULT_WINDOW_TITLE GAME_TITLE
 #define DEFAULT_WINDOW_NOBORDER false
@@ -24,24 +24,98 @@
 #include "engine.h"
 
 #include "grid.h"
+#include "input.h"
+#include "raster.h"
 #include "debug.h"
 
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 
 /*
- * an array of events
- * each one is either true or false depending on the user input
+ * the inputs received by receive_events and not handled yet, in order
  */
-static bool s_events[__LAST_EVENT];
+static InputQueue s_inputs;
 
 /*
- * an array containing the key code for each event
+ * the auto-shift of the held left and right keys, which replaces the key repeat of the system for them
  */
-static bool s_keys[__LAST_EVENT];
+static AutoShift s_shift;
+
+/*
+ * the action of each key, by scancode, __LAST_EVENT if it has none
+ * s_shift_keymap overrides s_keymap when shift is held
+ * an action can have several keys, each key event is a single lookup
+ */
+static Event s_keymap[SDL_NUM_SCANCODES];
+static Event s_shift_keymap[SDL_NUM_SCANCODES];
+
+/*
+ * the direction each held key had when it was pressed, LEFT_EVENT or RIGHT_EVENT, __LAST_EVENT otherwise
+ * its release stops that auto-shift, even if shift changed in between
+ */
+static Event s_held[SDL_NUM_SCANCODES];
+
+/*
+ * the maximum length of a line of a keymap file
+ */
+#define MAX_KEYMAP_LINE_LENGTH 256
+
+/*
+ * the only characters displayed by draw_percentage and draw_statistics
+ * they are rendered once by load_resources, then numbers are composed from them
+ */
+#define GLYPHS "0123456789% ()"
+#define GLYPHS_COUNT ((int) sizeof(GLYPHS) - 1)
+
+/*
+ * a frame is recorded as a list of commands, which are only executed by update_screen
+ * so that, in dirty rectangles mode, they can be executed only where something has changed
+ */
+typedef enum {
+	BACKGROUND_COMMAND,
+	GRID_COMMAND, // copy the cached grid
+	PAUSE_COMMAND, // darken the whole window
+	QUADS_COMMAND // draw the quads from first to the first of the next command
+} CommandType;
+
+typedef struct {
+	CommandType type;
+	int first; // the number of quads pushed before this command
+} Command;
+
+/*
+ * a frame never needs more commands than this
+ * past MAX_DAMAGE damaged rectangles, the last one is extended instead
+ */
+#define MAX_COMMANDS 16
+#define MAX_DAMAGE 16
+
+/*
+ * durations (frame times, latencies) are counted in buckets of TIME_BUCKET us, up to TIME_BUCKETS buckets
+ * the last bucket also counts every longer duration
+ */
+#define TIME_BUCKET 10
+#define TIME_BUCKETS 10000
+
+typedef struct {
+	unsigned int counts[TIME_BUCKETS];
+	unsigned int count;
+	Uint64 max; // in us
+} Histogram;
+
+/*
+ * the inputs handled between two frames whose latency is measured, the next ones are ignored
+ */
+#define MAX_TRACKED_INPUTS 64
+
+/*
+ * the scheduler sleeps until this number of us before the end of a frame, then spins
+ * because the delay of SDL_Delay can be a few ms longer than asked
+ */
+#define FRAME_SPIN_US 2000
 
 /*
  * this struct keeps in memory the main components of the game*
@@ -53,82 +127,867 @@ static struct {
 	SDL_Window *window;
 	SDL_Renderer *renderer;
 
-	SDL_Texture *blocks, *background, *pause;
-	SDL_Rect pausedst; // used to store the coordinates of the pause text
+	SDL_Texture *background; // already scaled and positioned, it covers the whole window
+
+	/*
+	 * a single texture holding, from top to bottom,
+	 * the blocks, the glyphs of the numbers and the pause text
+	 * so that everything can be drawn in a single batch
+	 */
+	SDL_Texture *atlas;
+	int atlas_width, atlas_height;
+
+	SDL_Rect glyphsrc[GLYPHS_COUNT]; // the part of the atlas where each character is drawn
+
+	SDL_Rect pausesrc; // if pausesrc.w is 0, there is no pause text
+	SDL_Rect pausedst; // used to store the coordinates of the pause text
+
+	/*
+	 * the quads of the current frame, four vertices and six indices per quad
+	 */
+	SDL_Vertex *vertices;
+	int *indices;
+	int quads, max_quads;
+
+	Command commands[MAX_COMMANDS];
+	int command_count;
+
+	/*
+	 * in dirty rectangles mode, what is currently displayed in the window
+	 * and the parts of the window which the current frame changes
+	 * if full_damage, the whole window must be redrawn
+	 */
+	SDL_Vertex *drawn_vertices;
+	int drawn_quads, max_drawn_quads;
+
+	Command drawn_commands[MAX_COMMANDS];
+	int drawn_command_count;
+
+	Row *drawn_rows;
+
+	SDL_Rect damage[MAX_DAMAGE];
+	int damage_count;
+	bool full_damage;
+
+	/*
+	 * the frozen blocks of locked_grid, as it was when its version was locked_version
+	 * if locked_grid is NULL, the texture must be redrawn
+	 */
+	SDL_Texture *locked;
+	const Grid *locked_grid;
+	unsigned int locked_version;
+
+	/*
+	 * with the raster backend, the images replacing the textures above
+	 * and the frame they are drawn into, sent to the window with the frame texture
+	 */
+	Image *background_image, *atlas_image, *locked_image;
+	Image *frame_image;
+	SDL_Texture *frame;
+
+	/*
+	 * in capture mode, the frames are drawn in this texture instead of the hidden window
+	 */
+	SDL_Texture *offscreen;
+
+	Uint64 start_counter; // the performance counter when the engine was started
+
+	/*
+	 * what draw_game built the current frame from, so that redraw_tetri can patch it
+	 * the falling tetri and its fallen position are the quads from built_tetri, -1 if there is no frame
+	 */
+	const Grid *built_grid;
+	unsigned int built_version;
+	bool built_pause;
+	int built_tetri;
+
+	/*
+	 * the frame scheduler, in performance counter ticks so that 1000 / framerate isn't rounded
+	 * if frame_period is 0, frames aren't paced by the scheduler
+	 */
+	Uint64 frame_period, frame_deadline;
+	Uint64 frame_end; // when the last frame ended, 0 before the first frame
+
+	Histogram frame_times;
+
+	/*
+	 * the time of the inputs handled since the last frame (like receive_events),
+	 * then the time between each input and the end of update_screen
+	 */
+	uint32_t tracked_inputs[MAX_TRACKED_INPUTS];
+	int tracked_count;
+
+	Histogram latencies;
+	Uint64 last_latency; // in us
+
+	/*
+	 * with settings->inject, the scancodes of the left and right keys,
+	 * the number of presses injected and when the next one is due
+	 */
+	SDL_Scancode inject_keys[2];
+	int injected;
+	uint32_t next_inject;
+
+	TTF_Font *font;
+
+	int width, height; // the window's width and height
+} s_engine;
+
+static Settings *s_settings;
+
+
+/*
+ * add the src part of the atlas, drawn at dst with opacity, to the batch
+ */
+static void push_quad(const SDL_Rect *src, const SDL_Rect *dst, int opacity) {
+	assert(src != NULL);
+	assert(dst != NULL);
+	assert(opacity >= 0); assert(opacity < 256);
+
+	if(s_engine.quads == s_engine.max_quads) {
+		int max_quads = s_engine.max_quads > 0 ? s_engine.max_quads * 2 : 64;
+
+		SDL_Vertex *vertices = realloc(s_engine.vertices, sizeof(SDL_Vertex) * 4 * (size_t) max_quads);
+		if(vertices != NULL) {
+			s_engine.vertices = vertices;
+		}
+
+		int *indices = realloc(s_engine.indices, sizeof(int) * 6 * (size_t) max_quads);
+		if(indices != NULL) {
+			s_engine.indices = indices;
+		}
+
+		if(!vertices || !indices) {
+			fprintf(stderr, "Couldn't allocate %zu bytes!\n", (sizeof(SDL_Vertex) * 4 + sizeof(int) * 6) * (size_t) max_quads);
+			return;
+		}
+
+		// the indices never change: two triangles per quad
+		for(int quad = s_engine.max_quads; quad < max_quads; quad++) {
+			int *index = s_engine.indices + 6 * quad;
+
+			index[0] = 4 * quad; index[1] = 4 * quad + 1; index[2] = 4 * quad + 2;
+			index[3] = 4 * quad + 2; index[4] = 4 * quad + 1; index[5] = 4 * quad + 3;
+		}
+
+		s_engine.max_quads = max_quads;
+	}
+
+	float left = (float) src->x / (float) s_engine.atlas_width;
+	float right = (float) (src->x + src->w) / (float) s_engine.atlas_width;
+	float top = (float) src->y / (float) s_engine.atlas_height;
+	float bottom = (float) (src->y + src->h) / (float) s_engine.atlas_height;
+
+	SDL_Color color = {255, 255, 255, (Uint8) opacity};
+
+	SDL_Vertex *vertex = s_engine.vertices + 4 * s_engine.quads;
+
+	vertex[0].position.x = (float) dst->x; vertex[0].position.y = (float) dst->y;
+	vertex[0].tex_coord.x = left; vertex[0].tex_coord.y = top;
+
+	vertex[1].position.x = (float) (dst->x + dst->w); vertex[1].position.y = (float) dst->y;
+	vertex[1].tex_coord.x = right; vertex[1].tex_coord.y = top;
+
+	vertex[2].position.x = (float) dst->x; vertex[2].position.y = (float) (dst->y + dst->h);
+	vertex[2].tex_coord.x = left; vertex[2].tex_coord.y = bottom;
+
+	vertex[3].position.x = (float) (dst->x + dst->w); vertex[3].position.y = (float) (dst->y + dst->h);
+	vertex[3].tex_coord.x = right; vertex[3].tex_coord.y = bottom;
+
+	for(int index = 0; index < 4; index++) {
+		vertex[index].color = color;
+	}
+
+	s_engine.quads++;
+}
+
+
+/*
+ * add a command to the current frame
+ * consecutive quads are drawn by a single command
+ */
+static void push_command(CommandType type) {
+	assert(s_engine.command_count < MAX_COMMANDS);
+
+	if(type == QUADS_COMMAND && s_engine.command_count > 0
+		&& s_engine.commands[s_engine.command_count - 1].type == QUADS_COMMAND) {
+		return;
+	}
+
+	Command *command = s_engine.commands + s_engine.command_count;
+	command->type = type;
+	command->first = s_engine.quads;
+
+	s_engine.command_count++;
+}
+
+
+/*
+ * return the number of the quad following the last one drawn by commands[index]
+ */
+static inline int command_end(const Command *commands, int count, int index, int quads) {
+	return index + 1 < count ? commands[index + 1].first : quads;
+}
+
+
+/*
+ * return an opaque color in the format of the images and of the surfaces
+ */
+static inline uint32_t pack_color(int red, int green, int blue) {
+	return 0xFF000000 | (uint32_t) red << 16 | (uint32_t) green << 8 | (uint32_t) blue;
+}
+
+
+/*
+ * return the rectangle covered by the quad starting at vertex
+ */
+static inline SDL_Rect quad_rect(const SDL_Vertex *vertex) {
+	SDL_Rect rect;
+
+	rect.x = (int) vertex[0].position.x;
+	rect.y = (int) vertex[0].position.y;
+	rect.w = (int) vertex[3].position.x - rect.x;
+	rect.h = (int) vertex[3].position.y - rect.y;
+
+	return rect;
+}
+
+
+/*
+ * draw the quads from first to end in dest with the raster backend
+ * if blend is false, their pixels are copied as they are
+ */
+static void raster_quads(Image *dest, const Area *clip, int first, int end, bool blend) {
+	assert(dest != NULL);
+	assert(s_engine.atlas_image != NULL);
+
+	for(int quad = first; quad < end; quad++) {
+		const SDL_Vertex *vertex = s_engine.vertices + 4 * quad;
+
+		// the part of the atlas is found back from the texture coordinates
+		Area src_area;
+		src_area.x = (int) (vertex[0].tex_coord.x * (float) s_engine.atlas_width + 0.5f);
+		src_area.y = (int) (vertex[0].tex_coord.y * (float) s_engine.atlas_height + 0.5f);
+		src_area.w = (int) (vertex[3].tex_coord.x * (float) s_engine.atlas_width + 0.5f) - src_area.x;
+		src_area.h = (int) (vertex[3].tex_coord.y * (float) s_engine.atlas_height + 0.5f) - src_area.y;
+
+		SDL_Rect rect = quad_rect(vertex);
+		Area dest_area = {rect.x, rect.y, rect.w, rect.h};
+
+		if(blend) {
+			blend_image(dest, clip, s_engine.atlas_image, &src_area, &dest_area, vertex[0].color.a);
+		} else {
+			copy_image(dest, clip, s_engine.atlas_image, &src_area, dest_area.x, dest_area.y);
+		}
+	}
+}
+
+
+/*
+ * execute every command of the current frame with the raster backend
+ * then send the part of the frame inside clip (or the whole frame if clip is NULL) to the renderer
+ */
+static void raster_commands(const SDL_Rect *clip) {
+	assert(s_engine.frame_image != NULL);
+	assert(s_engine.frame != NULL);
+
+	Image *frame = s_engine.frame_image;
+	Area whole = {0, 0, frame->width, frame->height};
+
+	Area area, *clip_area = NULL;
+	if(clip != NULL) {
+		area.x = clip->x; area.y = clip->y;
+		area.w = clip->w; area.h = clip->h;
+		clip_area = &area;
+	}
+
+	for(int index = 0; index < s_engine.command_count; index++) {
+		const Command *command = s_engine.commands + index;
+
+		switch(command->type) {
+		case BACKGROUND_COMMAND:
+			if(s_engine.background_image != NULL) {
+				copy_image(frame, clip_area, s_engine.background_image, &whole, 0, 0);
+			} else {
+				fill_image(frame, clip_area, pack_color(s_settings->background_color.red,
+					s_settings->background_color.green, s_settings->background_color.blue));
+			}
+			break;
+
+		case GRID_COMMAND:
+			blend_image(frame, clip_area, s_engine.locked_image, &whole, &whole, 255);
+			break;
+
+		case PAUSE_COMMAND:
+			modulate_image(frame, clip_area, pack_color(s_settings->pause_color.red,
+				s_settings->pause_color.green, s_settings->pause_color.blue));
+			break;
+
+		case QUADS_COMMAND:
+			raster_quads(frame, clip_area, command->first,
+				command_end(s_engine.commands, s_engine.command_count, index, s_engine.quads), true);
+			break;
+		}
+	}
+
+	const uint32_t *pixels = frame->pixels;
+	if(clip != NULL) {
+		pixels += clip->y * frame->width + clip->x;
+	}
+
+	SDL_UpdateTexture(s_engine.frame, clip, pixels, frame->width * (int) sizeof(uint32_t));
+	SDL_RenderCopy(s_engine.renderer, s_engine.frame, clip, clip);
+}
+
+
+/*
+ * execute every command of the current frame
+ * the renderer's clip rectangle must be clip, the raster backend only draws inside it
+ */
+static void draw_commands(const SDL_Rect *clip) {
+	assert(s_engine.renderer != NULL);
+	assert(s_engine.atlas != NULL || s_engine.atlas_image != NULL);
+
+	if(s_settings->backend == RASTER_BACKEND) {
+		raster_commands(clip);
+		return;
+	}
+
+	for(int index = 0; index < s_engine.command_count; index++) {
+		const Command *command = s_engine.commands + index;
+
+		switch(command->type) {
+		case BACKGROUND_COMMAND:
+			if(s_engine.background != NULL) {
+				SDL_RenderCopy(s_engine.renderer, s_engine.background, NULL, NULL);
+			} else if(s_settings->dirty_rects) {
+				// SDL_RenderClear ignores the clip rectangle
+				SDL_SetRenderDrawBlendMode(s_engine.renderer, SDL_BLENDMODE_NONE);
+				SDL_RenderFillRect(s_engine.renderer, NULL);
+				SDL_SetRenderDrawBlendMode(s_engine.renderer, SDL_BLENDMODE_MOD);
+			} else {
+				SDL_RenderClear(s_engine.renderer);
+			}
+			break;
+
+		case GRID_COMMAND:
+			SDL_RenderCopy(s_engine.renderer, s_engine.locked, NULL, NULL);
+			break;
+
+		case PAUSE_COMMAND:
+			SDL_SetRenderDrawColor(s_engine.renderer,
+				(Uint8) s_settings->pause_color.red,
+				(Uint8) s_settings->pause_color.green,
+				(Uint8) s_settings->pause_color.blue, 255);
+
+			SDL_RenderFillRect(s_engine.renderer, NULL);
+
+			SDL_SetRenderDrawColor(s_engine.renderer,
+				(Uint8) s_settings->background_color.red,
+				(Uint8) s_settings->background_color.green,
+				(Uint8) s_settings->background_color.blue, 255);
+			break;
+
+		case QUADS_COMMAND:
+			;
+			int end = command_end(s_engine.commands, s_engine.command_count, index, s_engine.quads);
+
+			if(end > command->first) {
+				SDL_RenderGeometry(s_engine.renderer, s_engine.atlas,
+					s_engine.vertices, 4 * end,
+					s_engine.indices + 6 * command->first, 6 * (end - command->first));
+			}
+			break;
+		}
+	}
+}
+
+
+/*
+ * mark rect as changed by the current frame
+ */
+static void add_damage(SDL_Rect rect) {
+	SDL_Rect window = {0, 0, s_engine.width, s_engine.height};
+	SDL_Rect damage;
+
+	if(s_engine.full_damage || !SDL_IntersectRect(&rect, &window, &damage)) {
+		return;
+	}
+
+	for(int index = 0; index < s_engine.damage_count; index++) {
+		if(SDL_HasIntersection(&damage, s_engine.damage + index)) {
+			SDL_UnionRect(&damage, s_engine.damage + index, s_engine.damage + index);
+			return;
+		}
+	}
+
+	if(s_engine.damage_count == MAX_DAMAGE) {
+		SDL_UnionRect(&damage, s_engine.damage + MAX_DAMAGE - 1, s_engine.damage + MAX_DAMAGE - 1);
+	} else {
+		s_engine.damage[s_engine.damage_count++] = damage;
+	}
+}
+
+
+/*
+ * compare the commands of the current frame with the ones of the displayed frame
+ * every quad which appeared, disappeared or changed is damaged
+ * if the commands are not the same, the whole window is damaged
+ */
+static void compute_damage(void) {
+	if(s_engine.command_count != s_engine.drawn_command_count) {
+		s_engine.full_damage = true;
+		return;
+	}
+
+	for(int index = 0; index < s_engine.command_count; index++) {
+		const Command *command = s_engine.commands + index;
+		const Command *drawn = s_engine.drawn_commands + index;
+
+		if(command->type != drawn->type) {
+			s_engine.full_damage = true;
+			return;
+		}
+
+		if(command->type != QUADS_COMMAND) {
+			continue;
+		}
+
+		int count = command_end(s_engine.commands, s_engine.command_count, index, s_engine.quads) - command->first;
+		int drawn_count = command_end(s_engine.drawn_commands, s_engine.drawn_command_count, index, s_engine.drawn_quads) - drawn->first;
+
+		for(int quad = 0; quad < count || quad < drawn_count; quad++) {
+			const SDL_Vertex *vertex = quad < count ? s_engine.vertices + 4 * (command->first + quad) : NULL;
+			const SDL_Vertex *drawn_vertex = quad < drawn_count ? s_engine.drawn_vertices + 4 * (drawn->first + quad) : NULL;
+
+			if(vertex != NULL && drawn_vertex != NULL && memcmp(vertex, drawn_vertex, 4 * sizeof(SDL_Vertex)) == 0) {
+				continue;
+			}
+
+			if(vertex != NULL) {
+				add_damage(quad_rect(vertex));
+			}
+
+			if(drawn_vertex != NULL) {
+				add_damage(quad_rect(drawn_vertex));
+			}
+		}
+	}
+}
+
+
+/*
+ * keep the current frame as the displayed one, to be compared with the next frame
+ */
+static void remember_frame(void) {
+	if(s_engine.quads > s_engine.max_drawn_quads) {
+		SDL_Vertex *vertices = realloc(s_engine.drawn_vertices, sizeof(SDL_Vertex) * 4 * (size_t) s_engine.max_quads);
+		if(!vertices) {
+			fprintf(stderr, "Couldn't allocate %zu bytes!\n", sizeof(SDL_Vertex) * 4 * (size_t) s_engine.max_quads);
+
+			// the next frame will be entirely redrawn
+			s_engine.drawn_command_count = -1;
+			return;
+		}
+
+		s_engine.drawn_vertices = vertices;
+		s_engine.max_drawn_quads = s_engine.max_quads;
+	}
+
+	memcpy(s_engine.drawn_vertices, s_engine.vertices, sizeof(SDL_Vertex) * 4 * (size_t) s_engine.quads);
+	s_engine.drawn_quads = s_engine.quads;
+
+	memcpy(s_engine.drawn_commands, s_engine.commands, sizeof(Command) * (size_t) s_engine.command_count);
+	s_engine.drawn_command_count = s_engine.command_count;
+}
+
+
+/*
+ * return the part of the atlas holding the block of color
+ */
+static inline SDL_Rect block_src(Colors color) {
+	SDL_Rect src_rect;
+
+	src_rect.y = 0;
+	src_rect.x = s_settings->block_size * (int)color;
+	src_rect.w = s_settings->block_size; src_rect.h = s_settings->block_size;
+
+	return src_rect;
+}
+
+
+/*
+ * add the four blocks of tetri to the batch, its pivot block being at x, y in pixels
+ * the command drawing them is up to the caller
+ */
+static void push_tetri(const Tetri *tetri, int x, int y, int opacity) {
+	assert(tetri != NULL);
+	assert(opacity >= 0); assert(opacity < 256);
+
+	// we select the color
+	SDL_Rect src_rect = block_src((Colors)tetri->type);
+
+	for(int index = 0; index < 4; index++) {
+		/*
+		 * we must compute the real coordinates of each block in the tetri
+		 */
+
+		int real_x = x + tetri->shape->x[index] * s_settings->block_size;
+		int real_y = y + tetri->shape->y[index] * s_settings->block_size;
+
+		SDL_Rect dest_rect;
+
+		dest_rect.y = real_y; dest_rect.x = real_x;
+		dest_rect.w = s_settings->block_size; dest_rect.h = s_settings->block_size;
+
+		push_quad(&src_rect, &dest_rect, opacity);
+	}
+}
+
+
+/*
+ * count a duration of us microseconds in histogram
+ */
+static void record_duration(Histogram *histogram, Uint64 us) {
+	assert(histogram != NULL);
+
+	Uint64 bucket = us / TIME_BUCKET;
+	histogram->counts[bucket < TIME_BUCKETS ? bucket : TIME_BUCKETS - 1]++;
+	histogram->count++;
+
+	if(us > histogram->max) {
+		histogram->max = us;
+	}
+}
+
+
+/*
+ * return the duration (in us) which permille / 1000 of the durations counted by histogram don't exceed
+ * it is the upper bound of a bucket
+ */
+static Uint64 duration_percentile(const Histogram *histogram, int permille) {
+	assert(histogram != NULL);
+	assert(permille >= 0); assert(permille <= 1000);
+
+	unsigned int durations = 0;
+	for(int bucket = 0; bucket < TIME_BUCKETS; bucket++) {
+		durations += histogram->counts[bucket];
+
+		// the last bucket also counts the longest durations
+		if((uint64_t) durations * 1000 >= (uint64_t) histogram->count * (unsigned int) permille) {
+			return bucket < TIME_BUCKETS - 1 ? (Uint64) (bucket + 1) * TIME_BUCKET : histogram->max;
+		}
+	}
+
+	return histogram->max;
+}
+
+
+void clear_screen(void) {
+	assert(s_settings != NULL);
+	assert(!s_settings->leave);
+	assert(s_engine.renderer != NULL);
+
+	push_command(BACKGROUND_COMMAND);
+}
+
+
+bool capture_screen(const char *filename) {
+	assert(filename != NULL);
+	assert(s_settings != NULL);
+	assert(s_settings->capture != NULL);
+	assert(s_engine.renderer != NULL);
+
+	SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, s_engine.width, s_engine.height,
+		32, SDL_PIXELFORMAT_ARGB8888);
+	if(!surface) {
+		fprintf(stderr, "Couldn't create a %dx%d surface!\n=>\t%s\n", s_engine.width, s_engine.height, SDL_GetError());
+		return false;
+	}
+
+	// the raster backend's frame is already in memory, it doesn't depend on the renderer
+	if(s_engine.frame_image != NULL) {
+		for(int y = 0; y < s_engine.height; y++) {
+			memcpy((uint8_t*) surface->pixels + y * surface->pitch, s_engine.frame_image->pixels + y * s_engine.width,
+				sizeof(uint32_t) * (size_t) s_engine.width);
+		}
+	} else {
+		SDL_SetRenderTarget(s_engine.renderer, s_engine.offscreen);
+		SDL_RenderReadPixels(s_engine.renderer, NULL, SDL_PIXELFORMAT_ARGB8888, surface->pixels, surface->pitch);
+		SDL_SetRenderTarget(s_engine.renderer, NULL);
+	}
+
+	bool saved = true;
+
+	size_t length = strlen(filename);
+	if(length > 4 && strcmp(filename + length - 4, ".png") == 0) {
+		if(IMG_SavePNG(surface, filename) != 0) {
+			fprintf(stderr, "Couldn't save '%s'!\n=>\t%s\n", filename, IMG_GetError());
+			saved = false;
+		}
+	} else { // raw pixels, row after row
+		FILE *file = fopen(filename, "wb");
+		if(!file) {
+			fprintf(stderr, "Couldn't open '%s'!\n", filename);
+			saved = false;
+		} else {
+			for(int y = 0; y < s_engine.height && saved; y++) {
+				if(fwrite((uint8_t*) surface->pixels + y * surface->pitch, sizeof(uint32_t), (size_t) s_engine.width, file)
+					!= (size_t) s_engine.width) {
+
+					fprintf(stderr, "Couldn't write '%s'!\n", filename);
+					saved = false;
+				}
+			}
+
+			fclose(file);
+		}
+	}
+
+	SDL_FreeSurface(surface);
+
+	return saved;
+}
+
+
+/*
+ * add every filled case of grid to the batch
+ */
+static void render_grid(const Grid *grid) {
+	assert(grid != NULL);
+
+	// we select the color
+	SDL_Rect src_rect = block_src(GRAY);
+
+	const Row* rows = get_rows(grid);
+
+	for(int y = 0; y < s_settings->blocks_per_col; y++) {
+		if(rows[y] == 0) {
+			continue;
+		}
+
+		for(int x = 0; x < s_settings->blocks_per_row; x++) {
+			if(rows[y] & ((Row) 1 << x)) {
+				/*
+				 * we must compute the real coordinates of each filled case
+				 */
+
+				int real_x = x * s_settings->block_size;
+				int real_y = y * s_settings->block_size;
+
+				SDL_Rect dest_rect;
+
+				dest_rect.y = real_y; dest_rect.x = real_x;
+				dest_rect.w = s_settings->block_size; dest_rect.h = s_settings->block_size;
+
+				push_quad(&src_rect, &dest_rect, 255);
+			}
+		}
+	}
+}
+
+
+void draw_grid(const Grid *grid) {
+	assert(grid != NULL);
+	assert(s_settings != NULL);
+	assert(!s_settings->leave);
+	assert(s_engine.renderer != NULL);
+	assert(s_engine.atlas != NULL || s_engine.atlas_image != NULL);
+
+	// the changed rows are damaged
+	if(s_settings->dirty_rects) {
+		const Row *rows = get_rows(grid);
+		int top = s_settings->blocks_per_col, bottom = -1;
+
+		for(int y = 0; y < s_settings->blocks_per_col; y++) {
+			if(rows[y] != s_engine.drawn_rows[y]) {
+				if(y < top) {
+					top = y;
+				}
+
+				bottom = y;
+				s_engine.drawn_rows[y] = rows[y];
+			}
+		}
+
+		if(top <= bottom) {
+			SDL_Rect rect = {0, top * s_settings->block_size,
+				s_engine.width, (bottom - top + 1) * s_settings->block_size};
+			add_damage(rect);
+		}
+	}
+
+	// without a render target, the blocks are drawn one by one on every frame
+	if(s_engine.locked == NULL && s_engine.locked_image == NULL) {
+		push_command(QUADS_COMMAND);
+		render_grid(grid);
+		return;
+	}
+
+	if(s_engine.locked_image != NULL) {
+		if(grid != s_engine.locked_grid || get_grid_version(grid) != s_engine.locked_version) {
+			fill_image(s_engine.locked_image, NULL, 0);
+
+			// these quads are not part of the frame
+			int first = s_engine.quads;
+			render_grid(grid);
+			raster_quads(s_engine.locked_image, NULL, first, s_engine.quads, false);
+			s_engine.quads = first;
+
+			s_engine.locked_grid = grid;
+			s_engine.locked_version = get_grid_version(grid);
+		}
+	} else if(grid != s_engine.locked_grid || get_grid_version(grid) != s_engine.locked_version) {
+		SDL_SetRenderTarget(s_engine.renderer, s_engine.locked);
+
+		// the empty cases must stay transparent
+		SDL_SetRenderDrawColor(s_engine.renderer, 0, 0, 0, 0);
+		SDL_RenderClear(s_engine.renderer);
+
+		SDL_SetRenderDrawColor(s_engine.renderer,
+			(Uint8) s_settings->background_color.red,
+			(Uint8) s_settings->background_color.green,
+			(Uint8) s_settings->background_color.blue, 255);
+
+		// the blocks don't overlap, so they can be copied as they are, alpha included
+		SDL_SetTextureBlendMode(s_engine.atlas, SDL_BLENDMODE_NONE);
+
+		// these quads are not part of the frame
+		int first = s_engine.quads;
+		render_grid(grid);
+
+		SDL_RenderGeometry(s_engine.renderer, s_engine.atlas,
+			s_engine.vertices, 4 * s_engine.quads,
+			s_engine.indices + 6 * first, 6 * (s_engine.quads - first));
+
+		s_engine.quads = first;
+
+		SDL_SetTextureBlendMode(s_engine.atlas, SDL_BLENDMODE_BLEND);
+
+		SDL_SetRenderTarget(s_engine.renderer, NULL);
+
+		s_engine.locked_grid = grid;
+		s_engine.locked_version = get_grid_version(grid);
+	}
+
+	push_command(GRID_COMMAND);
+}
+
+
+/*
+ * draw string at (x, y), one glyph of the atlas at a time
+ * characters which are not in GLYPHS are skipped
+ */
+static void draw_text(const char *string, int x, int y) {
+	assert(string != NULL);
+	assert(s_engine.renderer != NULL);
+
+	push_command(QUADS_COMMAND);
+
+	for(; *string != '\0'; string++) {
+		const char *glyph = strchr(GLYPHS, *string);
+		if(glyph == NULL) {
+			continue;
+		}
+
+		SDL_Rect src_rect = s_engine.glyphsrc[glyph - GLYPHS];
+
+		SDL_Rect dest_rect = src_rect;
+		dest_rect.x = x; dest_rect.y = y;
+
+		if(src_rect.h > 0) {
+			push_quad(&src_rect, &dest_rect, 255);
+		}
+
+		x += src_rect.w;
+	}
+}
 
-	TTF_Font *font;
 
-	int width, height; // the window's width and height
-} s_engine;
+/*
+ * display "last latency (99th percentile)" in ms at the bottom right corner of the screen
+ */
+static void draw_latency(void) {
+	/* before displaying value, we need to write it in a complete string
+	 * an unsigned int needs at most 10 characters, 3 for " ()", 1 for \0
+	 */
+	char string[10 + 10 + 3 + 1];
+	snprintf(string, sizeof(string), "%u (%u)", (unsigned int) (s_engine.last_latency / 1000),
+		(unsigned int) (duration_percentile(&(s_engine.latencies), 990) / 1000));
 
-static Settings *s_settings;
+	int width = 0;
+	for(const char *character = string; *character != '\0'; character++) {
+		width += s_engine.glyphsrc[strchr(GLYPHS, *character) - GLYPHS].w;
+	}
 
+	draw_text(string, s_engine.width - 10 - width, s_engine.height - 10 - s_engine.glyphsrc[0].h);
+}
 
-void clear_screen(void) {
-	assert(s_settings != NULL);
-	assert(!s_settings->leave);
-	assert(s_engine.renderer != NULL);
 
-	SDL_RenderClear(s_engine.renderer);
+/*
+ * add the current tetri of game at time now to the batch, then its fallen position if it is foreseen
+ */
+static void push_game_tetri(const GameState *game, uint32_t now) {
+	assert(game != NULL);
 
-	if(s_engine.background != NULL) {
-		if(s_settings->background_crop) {
-			int background_width, background_height;
-			SDL_QueryTexture(s_engine.background, NULL, NULL, &background_width, &background_height);
+	Tetri tetri = game->tetri;
+	Tetri fallen = find_fallen_position(game->grid, &tetri);
 
-			SDL_Rect dest_rect;
-			dest_rect.x = 0; dest_rect.y = 0;
-			dest_rect.w = background_width; dest_rect.h = background_height;
+	/*
+	 * the tetri slides down to the next row as the delay before the next move down passes
+	 * unless it lies on the frozen blocks already
+	 */
+	int y = tetri.py * s_settings->block_size;
+	if(fallen.py > tetri.py) {
+		y += movedown_progress(game, now, s_settings->block_size);
+	}
 
-			if(s_settings->background_center) {
-				dest_rect.x = s_engine.width / 2 - dest_rect.w / 2;
-				dest_rect.y = s_engine.height / 2 - dest_rect.h / 2;
-			}
+	push_tetri(&tetri, tetri.px * s_settings->block_size, y, 255);
 
-			SDL_RenderCopy(s_engine.renderer, s_engine.background, NULL, &dest_rect);
-		} else { // stretch background texture
-			SDL_RenderCopy(s_engine.renderer, s_engine.background, NULL, NULL);
-		}
+	// hints about the tetri position when fallen
+	if(s_settings->foresee_fallen && !game->pause) {
+		push_tetri(&fallen, fallen.px * s_settings->block_size, fallen.py * s_settings->block_size,
+			s_settings->fallen_opacity);
 	}
 }
 
 
-void draw_grid(void) {
+void draw_game(const GameState *game, uint32_t now) {
+	assert(game != NULL);
 	assert(s_settings != NULL);
-	assert(!s_settings->leave);
-	assert(s_engine.renderer != NULL);
-	assert(s_engine.blocks != NULL);
-
-	Colors color = GRAY;
 
-	SDL_Rect src_rect;
+	clear_screen();
 
-	// we select the color
-	src_rect.y = 0;
-	src_rect.x = s_settings->block_size * (int)color;
-	src_rect.w = s_settings->block_size; src_rect.h = s_settings->block_size;
+	// the grid first, so that everything else can be drawn in a single batch
+	draw_grid(game->grid);
 
-	const Case** grid = get_grid();
+	push_command(QUADS_COMMAND);
 
-	for(int y = 0; y < s_settings->blocks_per_col; y++) {
-		for(int x = 0; x < s_settings->blocks_per_row; x++) {
-			if(grid[y][x] == FILLED_CASE) {
-				/*
-				 * we must compute the real coordinates of each filled case
-				 */
+	s_engine.built_grid = game->grid;
+	s_engine.built_version = get_grid_version(game->grid);
+	s_engine.built_pause = game->pause;
+	s_engine.built_tetri = s_engine.quads;
 
-				int real_x = x * s_settings->block_size;
-				int real_y = y * s_settings->block_size;
+	push_game_tetri(game, now);
 
-				SDL_Rect dest_rect;
+	if(game->pause) {
+		draw_pause();
+	} else {
+		if(s_settings->preview) {
+			Tetri next = game->next;
+			draw_preview(&next);
+		}
 
-				dest_rect.y = real_y; dest_rect.x = real_x;
-				dest_rect.w = s_settings->block_size; dest_rect.h = s_settings->block_size;
+		draw_statistics(game->level, game->completed_rows);
 
-				SDL_RenderCopy(s_engine.renderer, s_engine.blocks, &src_rect, &dest_rect);
-			}
+		if(s_settings->hints) {
+			draw_percentage(movedown_progress(game, now, 100));
 		}
 	}
+
+	if(s_settings->latency_report) {
+		draw_latency();
+	}
 }
 
 
@@ -137,21 +996,12 @@ void draw_pause(void) {
 	assert(!s_settings->leave);
 	assert(s_engine.renderer != NULL);
 
-	SDL_SetRenderDrawColor(s_engine.renderer,
-		(Uint8) s_settings->pause_color.red,
-		(Uint8) s_settings->pause_color.green,
-		(Uint8) s_settings->pause_color.blue, 255);
-
-	SDL_RenderFillRect(s_engine.renderer, NULL);
-
-	SDL_SetRenderDrawColor(s_engine.renderer,
-		(Uint8) s_settings->background_color.red,
-		(Uint8) s_settings->background_color.green,
-		(Uint8) s_settings->background_color.blue, 255);
+	push_command(PAUSE_COMMAND);
 
 	// if pause_message is empty, no need to draw it
-	if(s_engine.pause != NULL) {
-		SDL_RenderCopy(s_engine.renderer, s_engine.pause, NULL, &(s_engine.pausedst));
+	if(s_engine.pausesrc.w > 0) {
+		push_command(QUADS_COMMAND);
+		push_quad(&(s_engine.pausesrc), &(s_engine.pausedst), 255);
 	}
 
 }
@@ -169,43 +1019,7 @@ void draw_percentage(int value) {
 	char string[5];
 	snprintf(string, 5, "%d%%", value);
 
-
-	SDL_Color color = {
-		(unsigned char) s_settings->font_color.red,
-		(unsigned char) s_settings->font_color.green,
-		(unsigned char) s_settings->font_color.blue, 0};
-
-	SDL_Surface *stext = TTF_RenderText_Blended(s_engine.font, string, color);
-	if(!stext) {
-		fprintf(stderr, "Couldn't render '%s' (Blended)!\n=>\t%s\n", string, TTF_GetError());
-	} else {
-		SDL_Texture *text = SDL_CreateTextureFromSurface(s_engine.renderer, stext);
-
-		SDL_Rect textdst;
-		textdst.x = 10; textdst.y = 10;
-		TTF_SizeText(s_engine.font, string, &textdst.w, &textdst.h);
-
-		SDL_RenderCopy(s_engine.renderer, text, NULL, &textdst);
-
-		SDL_DestroyTexture(text);
-		SDL_FreeSurface(stext);
-	}
-}
-
-
-/*
- * this function is used to compute how many characters are needed
- * to represent number in a char[]
- */
-static int count_numberstr(int number) {
-	assert(number >= 0);
-
-	int count = 1;
-	while((number /= 10) >= 1) {
-		count++;
-	}
-
-	return count;
+	draw_text(string, 10, 10);
 }
 
 
@@ -217,272 +1031,292 @@ void draw_statistics(int level, int rows) {
 	assert(rows >= 0);
 
 	/* before displaying value, we need to write it in a complete string
-	 * we need to estimate how many characters we need to represent each number
-	 * we will use VLA (Variable Length Array), which are optional in C11
+	 * an int needs at most 10 characters, 3 for " ()", 1 for \0
 	 */
-	int chars_for_rows = count_numberstr(rows);
-	int chars_for_level = count_numberstr(level);
-	int total = chars_for_rows + chars_for_level + 3 + 1; // 3 for " ()", 1 for \0
-
-	char string[total];
-	snprintf(string, (size_t)total, "%d (%d)", level, rows);
-
-	SDL_Color color = {
-		(unsigned char) s_settings->font_color.red,
-		(unsigned char) s_settings->font_color.green,
-		(unsigned char) s_settings->font_color.blue, 0};
-
-	SDL_Surface *stext = TTF_RenderText_Blended(s_engine.font, string, color);
-	if(!stext) {
-		fprintf(stderr, "Couldn't render '%s' (Blended)!\n=>\t%s\n", string, TTF_GetError());
-	} else {
-		SDL_Texture *text = SDL_CreateTextureFromSurface(s_engine.renderer, stext);
-
-		SDL_Rect textdst;
-		textdst.x = 10; textdst.y = s_engine.height - 10;
-
-		TTF_SizeText(s_engine.font, string, &textdst.w, &textdst.h);
-		textdst.y -= textdst.h; // to display the informations below the percentage
-
-		SDL_RenderCopy(s_engine.renderer, text, NULL, &textdst);
-
-		SDL_DestroyTexture(text);
-		SDL_FreeSurface(stext);
-	}
+	char string[10 + 10 + 3 + 1];
+	snprintf(string, sizeof(string), "%d (%d)", level, rows);
 
+	// to display the informations below the percentage
+	draw_text(string, 10, s_engine.height - 10 - s_engine.glyphsrc[0].h);
 }
 
 
 void draw_preview(Tetri *tetri) {
 	assert(s_settings != NULL);
 	assert(s_engine.renderer != NULL);
-	assert(s_engine.blocks != NULL);
-
-	Colors color = (Colors)tetri->type;
-
-	SDL_Rect src_rect;
+	assert(s_engine.atlas != NULL || s_engine.atlas_image != NULL);
 
 	// we select the color
-	src_rect.y = 0;
-	src_rect.x = s_settings->block_size * (int)color;
-	src_rect.w = s_settings->block_size; src_rect.h = s_settings->block_size;
+	SDL_Rect src_rect = block_src((Colors)tetri->type);
 
 	int init_x = s_engine.width - (4 * s_settings->preview_size);
 	int init_y = 2 * s_settings->preview_size;
 
-	SDL_SetTextureAlphaMod(s_engine.blocks, 200);
+	push_command(QUADS_COMMAND);
 
 	for(int index = 0; index < 4; index++) {
 		/*
 		 * we must compute the real coordinates of each block in the tetri
 		 */
 
-		int real_x = init_x + (tetri->x[index] * s_settings->preview_size);
-		int real_y = init_y + (tetri->y[index] * s_settings->preview_size);
+		int real_x = init_x + (tetri->shape->x[index] * s_settings->preview_size);
+		int real_y = init_y + (tetri->shape->y[index] * s_settings->preview_size);
 
 		SDL_Rect dest_rect;
 
 		dest_rect.y = real_y; dest_rect.x = real_x;
 		dest_rect.w = s_settings->preview_size; dest_rect.h = s_settings->preview_size;
 
-		SDL_RenderCopy(s_engine.renderer, s_engine.blocks, &src_rect, &dest_rect);
+		push_quad(&src_rect, &dest_rect, 200);
 	}
-
-	SDL_SetTextureAlphaMod(s_engine.blocks, 255);
 }
 
 
 void draw_tetri(Tetri *tetri, int opacity) {
 	assert(s_settings != NULL);
 	assert(s_engine.renderer != NULL);
-	assert(s_engine.blocks != NULL);
-	assert(opacity >= 0); assert(opacity < 256);
+	assert(s_engine.atlas != NULL || s_engine.atlas_image != NULL);
 
-	SDL_SetTextureAlphaMod(s_engine.blocks, (Uint8) opacity);
+	push_command(QUADS_COMMAND);
+	push_tetri(tetri, tetri->px * s_settings->block_size, tetri->py * s_settings->block_size, opacity);
+}
 
-	Colors color = (Colors)tetri->type;
 
-	SDL_Rect src_rect;
+void redraw_tetri(const GameState *game, uint32_t now) {
+	assert(game != NULL);
+	assert(s_settings != NULL);
+	assert(s_engine.built_tetri >= 0);
 
-	// we select the color
-	src_rect.y = 0;
-	src_rect.x = s_settings->block_size * (int)color;
-	src_rect.w = s_settings->block_size; src_rect.h = s_settings->block_size;
+	// only the quads of the falling tetri change if nothing else did
+	if(game->grid == s_engine.built_grid && get_grid_version(game->grid) == s_engine.built_version
+		&& game->pause == s_engine.built_pause) {
 
-	for(int index = 0; index < 4; index++) {
-		/*
-		 * we must compute the real coordinates of each block in the tetri
-		 */
+		int quads = s_engine.quads;
 
-		int real_x = (tetri->px + tetri->x[index]) * s_settings->block_size;
-		int real_y = (tetri->py + tetri->y[index]) * s_settings->block_size;
+		s_engine.quads = s_engine.built_tetri;
+		push_game_tetri(game, now);
+		s_engine.quads = quads;
+	} else {
+		s_engine.quads = 0;
+		s_engine.command_count = 0;
 
-		SDL_Rect dest_rect;
+		draw_game(game, now);
+	}
+}
 
-		dest_rect.y = real_y; dest_rect.x = real_x;
-		dest_rect.w = s_settings->block_size; dest_rect.h = s_settings->block_size;
 
-		SDL_RenderCopy(s_engine.renderer, s_engine.blocks, &src_rect, &dest_rect);
+uint64_t get_us(void) {
+	assert(s_settings != NULL);
+
+	Uint64 ticks = SDL_GetPerformanceCounter() - s_engine.start_counter;
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+
+	return (uint64_t) (ticks / frequency * 1000000 + ticks % frequency * 1000000 / frequency);
+}
+
+
+/*
+ * convert timestamp, from SDL_GetTicks, into the time of the inputs, like get_us but in ms
+ */
+static inline uint32_t input_time(Uint32 timestamp) {
+	return timestamp + ((uint32_t) (get_us() / 1000) - SDL_GetTicks());
+}
+
+
+/*
+ * queue the moves of auto-shift due until time
+ */
+static void queue_autoshift(uint32_t time) {
+	if(!repeat_autoshift(&s_shift, &s_inputs, time)) {
+		fprintf(stderr, "Couldn't queue an input, %d are already waiting!\n", INPUT_QUEUE_SIZE);
 	}
+}
 
-	// we reset the texture's opacity to its max value
-	SDL_SetTextureAlphaMod(s_engine.blocks, 255);
+
+/*
+ * release every held key at time
+ */
+static void release_held_keys(uint32_t time) {
+	for(int code = 0; code < SDL_NUM_SCANCODES; code++) {
+		if(s_held[code] != __LAST_EVENT) {
+			release_autoshift(&s_shift, s_held[code], time);
+			s_held[code] = __LAST_EVENT;
+		}
+	}
 }
 
 
-uint32_t get_ms(void) {
-	assert(s_settings != NULL);
+/*
+ * queue event, which SDL received at timestamp
+ */
+static void queue_event(Event event, Uint32 timestamp) {
+	uint32_t time = input_time(timestamp);
 
-	return SDL_GetTicks();
+	// the moves of auto-shift due before event come before it
+	queue_autoshift(time);
+
+	if(!push_input(&s_inputs, event, time)) {
+		fprintf(stderr, "Couldn't queue an input, %d are already waiting!\n", INPUT_QUEUE_SIZE);
+	}
 }
 
 
-void pause_engine(uint32_t ms) {
-	assert(s_settings != NULL);
-	assert(!s_settings->leave);
-	assert(s_engine.renderer != NULL);
+/*
+ * queue event for a key press, unless it is repeated and keyrepeat is off
+ */
+static void queue_key_event(Event event, const SDL_KeyboardEvent *key) {
+	assert(key != NULL);
 
-	SDL_Delay(ms);
+	if(!key->repeat || s_settings->keyrepeat) {
+		queue_event(event, key->timestamp);
+	}
 }
 
 
-static inline void reset_events(void) {
-	for(int index = 0; index < __LAST_EVENT; index++) {
-		s_events[index] = false;
+/*
+ * push a press of the left or right key, alternately, every INJECT_PERIOD ms
+ * then, once settings->inject keys have been pressed, ask to leave
+ */
+static void inject_events(void) {
+	uint32_t now = SDL_GetTicks();
+	if((int32_t) (now - s_engine.next_inject) < 0) {
+		return;
+	}
+
+	SDL_Event event;
+	memset(&event, 0, sizeof(event));
+
+	if(s_engine.injected == s_settings->inject) {
+		event.type = SDL_QUIT;
+		SDL_PushEvent(&event);
+		return;
 	}
+
+	event.key.keysym.scancode = s_engine.inject_keys[s_engine.injected % 2];
+
+	// SDL_PushEvent stamps them with the current time
+	event.type = SDL_KEYDOWN;
+	SDL_PushEvent(&event);
+
+	event.type = SDL_KEYUP;
+	SDL_PushEvent(&event);
+
+	s_engine.injected++;
+	s_engine.next_inject = now + INJECT_PERIOD;
 }
 
 
-const bool* receive_events(void) {
+InputQueue* receive_events(void) {
 	assert(s_settings != NULL);
 	assert(!s_settings->leave);
 	assert(s_settings->keyrepeat != undef);
 
-	reset_events();
-
 	SDL_Event event;
-	bool kshift = false; // if a shift key is pressed
 
-	SDL_Keymod mods = SDL_GetModState();
-	if(mods & KMOD_SHIFT) {
-		kshift = true;
+	if(s_settings->inject > 0) {
+		inject_events();
 	}
 
 	while(SDL_PollEvent(&event)) {
 		switch(event.type) {
 		case SDL_KEYDOWN:
 				;
-				SDL_Keycode code = event.key.keysym.sym;
-
-				if(code == s_keys[EXIT_EVENT]) {
-					s_events[EXIT_EVENT] = true;
-					return s_events; // no need to continue polling
-				}
+				SDL_Scancode code = event.key.keysym.scancode;
 
-				if(code == s_keys[LEFT_EVENT]) {
-					if(event.key.repeat) {
-						if(s_settings->keyrepeat) {
-							s_events[LEFT_EVENT] = true;
-						}
-					} else {
-						s_events[LEFT_EVENT] = true;
-					}
+				Event action = s_keymap[code];
+				if((event.key.keysym.mod & KMOD_SHIFT) && s_shift_keymap[code] != __LAST_EVENT) {
+					action = s_shift_keymap[code];
 				}
 
-				if(code == s_keys[RIGHT_EVENT]) {
-					if(event.key.repeat) {
+				switch(action) {
+				case LEFT_EVENT:
+				case RIGHT_EVENT:
+					// auto-shift repeats left and right itself
+					if(!event.key.repeat) {
+						queue_event(action, event.key.timestamp);
 						if(s_settings->keyrepeat) {
-							s_events[RIGHT_EVENT] = true;
-						}
-					} else {
-						s_events[RIGHT_EVENT] = true;
-					}
-				}
+							uint32_t time = input_time(event.key.timestamp);
 
-				if(code == s_keys[ROTATE_CLOCKWS_EVENT]) {
-					if(event.key.repeat) {
-						if(s_settings->keyrepeat) {
-							if(kshift) {
-								s_events[SHIFT_EVENT] = true;
-							} else {
-								s_events[ROTATE_CLOCKWS_EVENT] = true;
+							// a key is never held twice
+							if(s_held[code] != __LAST_EVENT) {
+								release_autoshift(&s_shift, s_held[code], time);
 							}
-						}
-					} else {
-						if(kshift && !s_settings->vi_mode) {
-							s_events[SHIFT_EVENT] = true;
-						} else {
-							s_events[ROTATE_CLOCKWS_EVENT] = true;
-						}
-					}
-				}
 
-				if(s_settings->vi_mode && code == s_keys[SHIFT_EVENT]) {
-					if(event.key.repeat) {
-						if(s_settings->keyrepeat) {
-							s_events[SHIFT_EVENT] = true;
+							press_autoshift(&s_shift, action, time);
+							s_held[code] = action;
 						}
-					} else {
-						s_events[SHIFT_EVENT] = true;
 					}
-				}
+					break;
 
-				if(code == s_keys[ROTATE_COUNTERCLOCKWS_EVENT]) {
-					if(event.key.repeat) {
-						if(s_settings->keyrepeat) {
-							s_events[ROTATE_COUNTERCLOCKWS_EVENT] = true;
-						}
-					} else {
-						s_events[ROTATE_COUNTERCLOCKWS_EVENT] = true;
+				case EXIT_EVENT:
+				case NEWGAME_EVENT:
+				case PAUSE_EVENT:
+					queue_event(action, event.key.timestamp);
+					break;
+
+				case DELETE_EVENT:
+					if(s_settings->cheatmode) {
+						queue_key_event(action, &(event.key));
 					}
-				}
+					break;
 
-				if(code == s_keys[PAUSE_EVENT]) {
-					s_events[PAUSE_EVENT] = true;
-				}
+				case __LAST_EVENT:
+					break;
 
-				if(code == s_keys[NEWGAME_EVENT]) {
-					s_events[NEWGAME_EVENT] = true;
+				default:
+					queue_key_event(action, &(event.key));
+					break;
 				}
+				break;
 
-				if(code == s_keys[DROP_EVENT]) {
-					if(event.key.repeat) {
-						if(s_settings->keyrepeat) {
-							s_events[DROP_EVENT] = true;
-						}
-					} else {
-						s_events[DROP_EVENT] = true;
-					}
-				}
+		case SDL_KEYUP:
+			if(s_held[event.key.keysym.scancode] != __LAST_EVENT) {
+				uint32_t time = input_time(event.key.timestamp);
 
-				if(code == s_keys[DELETE_EVENT]) {
-					if(s_settings->cheatmode) {
-						if(event.key.repeat) {
-							if(s_settings->keyrepeat) {
-								s_events[DELETE_EVENT] = true;
-							}
-						} else {
-							s_events[DELETE_EVENT] = true;
-						}
-					}
-				}
-				break;
+				queue_autoshift(time);
+				release_autoshift(&s_shift, s_held[event.key.keysym.scancode], time);
+				s_held[event.key.keysym.scancode] = __LAST_EVENT;
+			}
+			break;
 
 		case SDL_QUIT:
-			s_events[EXIT_EVENT] = true;
-			return s_events; // no need to continue polling
+			queue_event(EXIT_EVENT, event.common.timestamp);
+			break;
+
+		case SDL_RENDER_TARGETS_RESET:
+			// the content of the locked texture is lost
+			s_engine.locked_grid = NULL;
+			s_engine.full_damage = true;
+			break;
 
 		case SDL_WINDOWEVENT:
-			if(event.window.event == SDL_WINDOWEVENT_FOCUS_LOST) {
-				s_events[FOCUSLOST_EVENT] = true;
+			if(event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+				s_engine.full_damage = true;
+			} else if(event.window.event == SDL_WINDOWEVENT_FOCUS_LOST) {
+				queue_event(FOCUSLOST_EVENT, event.window.timestamp);
+
+				// the keys may be released in another window
+				release_held_keys(input_time(event.window.timestamp));
 			} else if(event.window.event == SDL_WINDOWEVENT_FOCUS_GAINED) {
-				s_events[FOCUSGAINED_EVENT] = true;
+				queue_event(FOCUSGAINED_EVENT, event.window.timestamp);
 			}
 			break;
 		}
 	}
 
-	return s_events;
+	// the moves of auto-shift due until now
+	queue_autoshift((uint32_t) (get_us() / 1000));
+
+	return &s_inputs;
+}
+
+
+void shift_new_tetri(uint32_t time) {
+	assert(s_settings != NULL);
+
+	if(!rearm_autoshift(&s_shift, &s_inputs, time)) {
+		fprintf(stderr, "Couldn't queue an input, %d are already waiting!\n", INPUT_QUEUE_SIZE);
+	}
 }
 
 
@@ -518,6 +1352,11 @@ static bool create_window(void) {
 		flags = SDL_WINDOW_BORDERLESS;
 	}
 
+	// in capture mode, nothing is shown
+	if(s_settings->capture != NULL) {
+		flags |= SDL_WINDOW_HIDDEN;
+	}
+
 	s_engine.window = SDL_CreateWindow(s_settings->window_title,
 		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
 		width, height, flags);
@@ -526,9 +1365,25 @@ static bool create_window(void) {
 		return false;
 	}
 
-	Uint32 renderer_flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC;
+	Uint32 renderer_flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+	if(s_settings->vsync) {
+		// the frame scheduler doesn't wait then, SDL_RenderPresent does
+		renderer_flags |= SDL_RENDERER_PRESENTVSYNC;
+	}
+	if(s_settings->capture != NULL) {
+		// any renderer will do, the dummy video driver only provides the software one
+		renderer_flags = SDL_RENDERER_TARGETTEXTURE;
+	}
 
-	s_engine.renderer = SDL_CreateRenderer(s_engine.window, -1, renderer_flags);
+	if(s_settings->dirty_rects) {
+		// the window surface keeps what is not redrawn from one frame to another
+		SDL_Surface *surface = SDL_GetWindowSurface(s_engine.window);
+		if(surface != NULL) {
+			s_engine.renderer = SDL_CreateSoftwareRenderer(surface);
+		}
+	} else {
+		s_engine.renderer = SDL_CreateRenderer(s_engine.window, -1, renderer_flags);
+	}
 	if(!s_engine.renderer) {
 		fprintf(stderr, "Couldn't create a renderer for %dx%d window!\n=>\t%s\n", width, height, SDL_GetError());
 		return false;
@@ -544,14 +1399,99 @@ static bool create_window(void) {
 static void tune_renderer(void) {
 	assert(s_engine.renderer != NULL);
 
-	// set a drawing color to the renderer
-	SDL_SetRenderDrawColor(s_engine.renderer,
-		(Uint8) s_settings->background_color.red,
-		(Uint8) s_settings->background_color.green,
-		(Uint8) s_settings->background_color.blue, 255);
+	// set a drawing color to the renderer
+	SDL_SetRenderDrawColor(s_engine.renderer,
+		(Uint8) s_settings->background_color.red,
+		(Uint8) s_settings->background_color.green,
+		(Uint8) s_settings->background_color.blue, 255);
+
+	// set a blendmode to the renderer
+	SDL_SetRenderDrawBlendMode(s_engine.renderer, SDL_BLENDMODE_MOD);
+}
+
+
+/*
+ * return a new image holding the pixels of surface, which must be in the ARGB8888 format
+ * return NULL if it couldn't be done
+ */
+static Image* image_from_surface(SDL_Surface *surface) {
+	assert(surface != NULL);
+	assert(surface->format->format == SDL_PIXELFORMAT_ARGB8888);
+
+	Image *image = create_image(surface->w, surface->h);
+	if(!image) {
+		return NULL;
+	}
+
+	SDL_LockSurface(surface);
+
+	for(int y = 0; y < surface->h; y++) {
+		memcpy(image->pixels + y * image->width, (const uint8_t*) surface->pixels + y * surface->pitch,
+			sizeof(uint32_t) * (size_t) surface->w);
+	}
+
+	SDL_UnlockSurface(surface);
+
+	return image;
+}
+
+
+/*
+ * store in s_engine.background (or s_engine.background_image with the raster backend)
+ * a picture of the size of the window, holding the background color
+ * and image scaled, cropped or centered as requested by the settings
+ * this is done once, so that clear_screen only has to copy it
+ * on failure, nothing is stored
+ */
+static void prepare_background(SDL_Surface *image) {
+	assert(image != NULL);
+
+	SDL_Surface *simage = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ARGB8888, 0);
+	SDL_Surface *sbackground = SDL_CreateRGBSurfaceWithFormat(0, s_engine.width, s_engine.height,
+		32, SDL_PIXELFORMAT_ARGB8888);
+
+	if(!simage || !sbackground) {
+		fprintf(stderr, "Couldn't create a %dx%d surface!\n=>\t%s\n", s_engine.width, s_engine.height, SDL_GetError());
+		SDL_ClearError();
+	} else {
+		SDL_FillRect(sbackground, NULL, pack_color(s_settings->background_color.red,
+			s_settings->background_color.green, s_settings->background_color.blue));
+
+		if(s_settings->background_crop) {
+			SDL_Rect dest_rect;
+			dest_rect.x = 0; dest_rect.y = 0;
+			dest_rect.w = simage->w; dest_rect.h = simage->h;
+
+			if(s_settings->background_center) {
+				dest_rect.x = s_engine.width / 2 - dest_rect.w / 2;
+				dest_rect.y = s_engine.height / 2 - dest_rect.h / 2;
+			}
+
+			SDL_BlitSurface(simage, NULL, sbackground, &dest_rect);
+		} else { // stretch background image
+			SDL_BlitScaled(simage, NULL, sbackground, NULL);
+		}
+
+		if(s_settings->backend == RASTER_BACKEND) {
+			s_engine.background_image = image_from_surface(sbackground);
+		} else {
+			s_engine.background = SDL_CreateTextureFromSurface(s_engine.renderer, sbackground);
+			if(!s_engine.background) {
+				fprintf(stderr, "Couldn't create a %dx%d texture!\n=>\t%s\n", s_engine.width, s_engine.height, SDL_GetError());
+				SDL_ClearError();
+			} else {
+				SDL_SetTextureBlendMode(s_engine.background, SDL_BLENDMODE_NONE);
+			}
+		}
+	}
+
+	if(simage != NULL) {
+		SDL_FreeSurface(simage);
+	}
 
-	// set a blendmode to the renderer
-	SDL_SetRenderDrawBlendMode(s_engine.renderer, SDL_BLENDMODE_MOD);
+	if(sbackground != NULL) {
+		SDL_FreeSurface(sbackground);
+	}
 }
 
 
@@ -578,15 +1518,78 @@ static bool load_resources(void) {
 	 */
 
 	if(s_settings->background_file != NULL) {
-		s_engine.background = IMG_LoadTexture(s_engine.renderer, s_settings->background_file);
-		if(!s_engine.background) {
+		SDL_Surface *sbackground = IMG_Load(s_settings->background_file);
+		if(!sbackground) {
 			fprintf(stderr, "Couldn't load image file '%s'!\n=>\t%s\n", s_settings->background_file, IMG_GetError());
 			// we can do without a background image, so leaving the game isn't mandatory
 
 			SDL_ClearError();
+		} else {
+			prepare_background(sbackground);
+			SDL_FreeSurface(sbackground);
 		}
 	} // we don't need to set s_engine.background to NULL, it is already NULL
 
+	/*
+	 * in dirty rectangles mode, the first frame is entirely drawn
+	 */
+
+	if(s_settings->dirty_rects) {
+		s_engine.drawn_rows = calloc((size_t) s_settings->blocks_per_col, sizeof(Row));
+		if(!s_engine.drawn_rows) {
+			fprintf(stderr, "Couldn't allocate %zu bytes!\n", sizeof(Row) * (size_t) s_settings->blocks_per_col);
+			return false;
+		}
+
+		s_engine.full_damage = true;
+	}
+
+	/*
+	 * with the raster backend, create the frame and the image where the frozen blocks are cached
+	 * otherwise, create the texture where the frozen blocks are cached
+	 */
+
+	if(s_settings->backend == RASTER_BACKEND) {
+		s_engine.frame_image = create_image(s_engine.width, s_engine.height);
+		s_engine.locked_image = create_image(s_engine.width, s_engine.height);
+		if(!s_engine.frame_image || !s_engine.locked_image) {
+			return false;
+		}
+
+		s_engine.frame = SDL_CreateTexture(s_engine.renderer, SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STREAMING, s_engine.width, s_engine.height);
+		if(!s_engine.frame) {
+			fprintf(stderr, "Couldn't create a %dx%d streaming texture!\n=>\t%s\n", s_engine.width, s_engine.height, SDL_GetError());
+			return false;
+		}
+
+		SDL_SetTextureBlendMode(s_engine.frame, SDL_BLENDMODE_NONE);
+	} else {
+		s_engine.locked = SDL_CreateTexture(s_engine.renderer, SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_TARGET, s_engine.width, s_engine.height);
+	}
+
+	if(s_settings->backend == SDL_BACKEND && !s_engine.locked) {
+		fprintf(stderr, "Couldn't create a %dx%d target texture!\n=>\t%s\n", s_engine.width, s_engine.height, SDL_GetError());
+		// the grid will simply be drawn block by block
+		SDL_ClearError();
+	} else if(s_engine.locked) {
+		SDL_SetTextureBlendMode(s_engine.locked, SDL_BLENDMODE_BLEND);
+	}
+
+	/*
+	 * in capture mode, create the texture where the frames are drawn
+	 */
+
+	if(s_settings->capture != NULL) {
+		s_engine.offscreen = SDL_CreateTexture(s_engine.renderer, SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_TARGET, s_engine.width, s_engine.height);
+		if(!s_engine.offscreen) {
+			fprintf(stderr, "Couldn't create a %dx%d target texture!\n=>\t%s\n", s_engine.width, s_engine.height, SDL_GetError());
+			return false;
+		}
+	}
+
 	/*
 	 * load block image file and retrieve each colored element
 	 * check this image file has the right width and height
@@ -594,8 +1597,8 @@ static bool load_resources(void) {
 
 	assert(s_settings->block_file != NULL);
 
-	s_engine.blocks = IMG_LoadTexture(s_engine.renderer, s_settings->block_file);
-	if(!s_engine.blocks) {
+	SDL_Surface *sblocks = IMG_Load(s_settings->block_file);
+	if(!sblocks) {
 		fprintf(stderr, "Couldn't load image file '%s'!\n=>\t%s\n", s_settings->block_file, IMG_GetError());
 		return false;
 	}
@@ -603,11 +1606,9 @@ static bool load_resources(void) {
 	int legal_width = s_settings->block_size * __LAST_COLOR;
 	int legal_height = s_settings->block_size;
 
-	int texture_width = 0, texture_height;
-	SDL_QueryTexture(s_engine.blocks, NULL, NULL, &texture_width, &texture_height);
-	if(texture_width != legal_width || texture_height != legal_height) {
+	if(sblocks->w != legal_width || sblocks->h != legal_height) {
 		fprintf(stderr, "Texture for '%s' is not the right size (%dx%d, should be %dx%d)!\n",
-			s_settings->block_file, texture_width, texture_height, legal_width, legal_height);
+			s_settings->block_file, sblocks->w, sblocks->h, legal_width, legal_height);
 	}
 
 	/*
@@ -621,72 +1622,294 @@ static bool load_resources(void) {
 	if(!s_engine.font) {
 		fprintf(stderr, "Couldn't load font file '%s' (%d px)!\n=>\t%s\n",
 			s_settings->font_file, s_settings->font_size, TTF_GetError());
+		SDL_FreeSurface(sblocks);
 		return false;
 	}
 
+	SDL_Color color = {
+		(unsigned char) s_settings->font_color.red,
+		(unsigned char) s_settings->font_color.green,
+		(unsigned char) s_settings->font_color.blue, 0};
+
 	/*
-	 * store the rendered pause text in an SDL_Texture for later use
+	 * render the pause text for later use
 	 */
 
+	SDL_Surface *spause = NULL;
+
 	TTF_Font *pause_font = TTF_OpenFont(s_settings->font_file, s_settings->font_size * 2);
 	if(!pause_font) {
 		fprintf(stderr, "Couldn't load font file '%s' (%d px)!\n=>\t%s\n",
 			s_settings->font_file, s_settings->font_size, TTF_GetError());
+		SDL_FreeSurface(sblocks);
 		return false;
 	} else {
-		SDL_Color color = {
-			(unsigned char) s_settings->font_color.red,
-			(unsigned char) s_settings->font_color.green,
-			(unsigned char) s_settings->font_color.blue, 0};
-
-		SDL_Surface *spause = TTF_RenderUTF8_Blended(pause_font, s_settings->pause_message, color);
+		spause = TTF_RenderUTF8_Blended(pause_font, s_settings->pause_message, color);
 
 		if(!spause) {
 			fprintf(stderr, "Couldn't render '%s' (Blended)!\n=>\t%s\n", s_settings->pause_message, TTF_GetError());
 			// no need to exit, the pause_message will simply not be displayed
 		} else {
-			s_engine.pause = SDL_CreateTextureFromSurface(s_engine.renderer, spause);
-
 			// compute the coordinates of the pause text (the center of the window)
 			int center_x = s_engine.width / 2;
 			int center_y = s_engine.height / 2;
 
-			SDL_QueryTexture(s_engine.pause, NULL, NULL, &(s_engine.pausedst.w), &(s_engine.pausedst.h));
+			s_engine.pausedst.w = spause->w;
+			s_engine.pausedst.h = spause->h;
 
 			s_engine.pausedst.x = center_x - s_engine.pausedst.w / 2;
 			s_engine.pausedst.y = center_y - s_engine.pausedst.h / 2;
-
-			SDL_FreeSurface(spause);
 		}
 
 		TTF_CloseFont(pause_font); pause_font = NULL;
 	}
 
-	return true;
-}
-
-
-const Settings* start_engine(int argc, char **argv) {
-	s_settings = parse_params(argc, argv);
-	assert(s_settings != NULL);
+	/*
+	 * render every glyph of the numbers displayed on the screen once and for all
+	 */
 
-	if(s_settings->leave) {
-		return s_settings;
+	SDL_Surface *sglyphs = TTF_RenderText_Blended(s_engine.font, GLYPHS, color);
+	if(!sglyphs) {
+		fprintf(stderr, "Couldn't render '%s' (Blended)!\n=>\t%s\n", GLYPHS, TTF_GetError());
+		// no need to exit, the numbers will simply not be displayed
 	}
 
 	/*
-	 * init random-ness, required for random tetriminos
+	 * gather the blocks, the glyphs and the pause text in the atlas, one below another
 	 */
 
-	srand((unsigned int) time(NULL));
+	SDL_Surface *parts[] = {sblocks, sglyphs, spause};
+	int parts_y[3];
+
+	s_engine.atlas_width = 0;
+	s_engine.atlas_height = 0;
+
+	for(int part = 0; part < 3; part++) {
+		parts_y[part] = s_engine.atlas_height;
+
+		if(parts[part] != NULL) {
+			if(parts[part]->w > s_engine.atlas_width) {
+				s_engine.atlas_width = parts[part]->w;
+			}
+
+			s_engine.atlas_height += parts[part]->h;
+		}
+	}
+
+	SDL_Surface *satlas = SDL_CreateRGBSurfaceWithFormat(0, s_engine.atlas_width, s_engine.atlas_height,
+		32, SDL_PIXELFORMAT_ARGB8888);
+	if(!satlas) {
+		fprintf(stderr, "Couldn't create a %dx%d surface!\n=>\t%s\n",
+			s_engine.atlas_width, s_engine.atlas_height, SDL_GetError());
+	} else {
+		SDL_FillRect(satlas, NULL, 0);
+
+		for(int part = 0; part < 3; part++) {
+			if(parts[part] == NULL) {
+				continue;
+			}
+
+			SDL_Rect dest_rect;
+			dest_rect.x = 0; dest_rect.y = parts_y[part];
+			dest_rect.w = parts[part]->w; dest_rect.h = parts[part]->h;
+
+			// copy the pixels as they are, alpha included
+			SDL_SetSurfaceBlendMode(parts[part], SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(parts[part], NULL, satlas, &dest_rect);
+		}
+
+		if(s_settings->backend == RASTER_BACKEND) {
+			s_engine.atlas_image = image_from_surface(satlas);
+		} else {
+			s_engine.atlas = SDL_CreateTextureFromSurface(s_engine.renderer, satlas);
+		}
+
+		SDL_FreeSurface(satlas);
+	}
 
 	/*
-	 * allocate the whole grid
-	 * check if it's all right
+	 * each glyph's width is the advance of its prefix, so that the kerning is kept
 	 */
-	
-	if(!init_grid(s_settings->blocks_per_col, s_settings->blocks_per_row)) {
-		s_settings->leave = true;
+
+	if(sglyphs != NULL) {
+		char prefix[GLYPHS_COUNT + 1];
+		int previous_width = 0;
+
+		for(int index = 0; index < GLYPHS_COUNT; index++) {
+			memcpy(prefix, GLYPHS, (size_t) index + 1);
+			prefix[index + 1] = '\0';
+
+			int width, height;
+			TTF_SizeText(s_engine.font, prefix, &width, &height);
+
+			s_engine.glyphsrc[index].x = previous_width;
+			s_engine.glyphsrc[index].y = parts_y[1];
+			s_engine.glyphsrc[index].w = width - previous_width;
+			s_engine.glyphsrc[index].h = height;
+
+			previous_width = width;
+		}
+
+		SDL_FreeSurface(sglyphs);
+	}
+
+	if(spause != NULL) {
+		s_engine.pausesrc.x = 0; s_engine.pausesrc.y = parts_y[2];
+		s_engine.pausesrc.w = spause->w; s_engine.pausesrc.h = spause->h;
+
+		SDL_FreeSurface(spause);
+	}
+
+	SDL_FreeSurface(sblocks);
+
+	if(s_settings->backend == RASTER_BACKEND) {
+		return s_engine.atlas_image != NULL;
+	}
+
+	if(!s_engine.atlas) {
+		fprintf(stderr, "Couldn't create the texture of '%s'!\n=>\t%s\n", s_settings->block_file, SDL_GetError());
+		return false;
+	}
+
+	SDL_SetTextureBlendMode(s_engine.atlas, SDL_BLENDMODE_BLEND);
+
+	return true;
+}
+
+
+/*
+ * bind key, as the layout of the keyboard names it, to event in keymap
+ */
+static void bind_key(Event *keymap, SDL_Keycode key, Event event) {
+	assert(keymap != NULL);
+
+	keymap[SDL_GetScancodeFromKey(key)] = event;
+}
+
+
+/*
+ * bind the normal or vi-like control keys, listed by print_help
+ */
+static void set_default_keymap(void) {
+	for(int code = 0; code < SDL_NUM_SCANCODES; code++) {
+		s_keymap[code] = __LAST_EVENT;
+		s_shift_keymap[code] = __LAST_EVENT;
+	}
+
+	// universal key controls
+	bind_key(s_keymap, SDLK_d, DELETE_EVENT);
+	bind_key(s_keymap, SDLK_SPACE, DROP_EVENT);
+	bind_key(s_keymap, SDLK_ESCAPE, EXIT_EVENT);
+	bind_key(s_keymap, SDLK_p, PAUSE_EVENT);
+
+	if(s_settings->vi_mode) {
+		bind_key(s_keymap, SDLK_s, LEFT_EVENT);
+		bind_key(s_keymap, SDLK_l, RIGHT_EVENT);
+		bind_key(s_keymap, SDLK_RETURN, NEWGAME_EVENT);
+		bind_key(s_keymap, SDLK_f, ROTATE_CLOCKWS_EVENT);
+		bind_key(s_keymap, SDLK_j, ROTATE_COUNTERCLOCKWS_EVENT);
+		bind_key(s_keymap, SDLK_k, SHIFT_EVENT);
+	} else {
+		bind_key(s_keymap, SDLK_LEFT, LEFT_EVENT);
+		bind_key(s_keymap, SDLK_RIGHT, RIGHT_EVENT);
+		bind_key(s_keymap, SDLK_n, NEWGAME_EVENT);
+		bind_key(s_keymap, SDLK_DOWN, ROTATE_CLOCKWS_EVENT);
+		bind_key(s_keymap, SDLK_UP, ROTATE_COUNTERCLOCKWS_EVENT);
+		bind_key(s_shift_keymap, SDLK_DOWN, SHIFT_EVENT);
+	}
+
+	// the scancode of unknown keys is SDL_SCANCODE_UNKNOWN, which is never received
+	s_keymap[SDL_SCANCODE_UNKNOWN] = __LAST_EVENT;
+	s_shift_keymap[SDL_SCANCODE_UNKNOWN] = __LAST_EVENT;
+}
+
+
+/*
+ * bind the keys listed in filename, each action listed losing its default keys
+ * return false if filename cannot be read or if a line is invalid
+ */
+static bool load_keymap(const char *filename) {
+	assert(filename != NULL);
+
+	FILE *file = fopen(filename, "r");
+	if(!file) {
+		fprintf(stderr, "Couldn't open '%s'!\n", filename);
+		return false;
+	}
+
+	bool rebound[__LAST_EVENT] = { false };
+	bool valid = true;
+
+	char line[MAX_KEYMAP_LINE_LENGTH];
+	for(int number = 1; valid && fgets(line, sizeof(line), file) != NULL; number++) {
+		char *name = strtok(line, " \t\r\n");
+
+		// empty line or comment
+		if(name == NULL || name[0] == '#') {
+			continue;
+		}
+
+		// the name of a key can contain spaces, it goes until the end of the line
+		char *key = strtok(NULL, "\r\n");
+		while(key != NULL && (*key == ' ' || *key == '\t')) {
+			key++;
+		}
+
+		Event event = find_event(name);
+		if(event == __LAST_EVENT || event == FOCUSGAINED_EVENT || event == FOCUSLOST_EVENT) {
+			fprintf(stderr, "'%s', line %d: unknown action '%s'!\n", filename, number, name);
+			valid = false;
+			continue;
+		}
+
+		if(key == NULL || *key == '\0') {
+			fprintf(stderr, "'%s', line %d: '%s' expects the name of a key!\n", filename, number, name);
+			valid = false;
+			continue;
+		}
+
+		Event *keymap = s_keymap;
+		if(strncmp(key, "shift+", strlen("shift+")) == 0) {
+			keymap = s_shift_keymap;
+			key += strlen("shift+");
+		}
+
+		SDL_Keycode code = SDL_GetKeyFromName(key);
+		if(code == SDLK_UNKNOWN || SDL_GetScancodeFromKey(code) == SDL_SCANCODE_UNKNOWN) {
+			fprintf(stderr, "'%s', line %d: unknown key '%s'!\n", filename, number, key);
+			valid = false;
+			continue;
+		}
+
+		if(!rebound[event]) {
+			for(int scancode = 0; scancode < SDL_NUM_SCANCODES; scancode++) {
+				if(s_keymap[scancode] == event) {
+					s_keymap[scancode] = __LAST_EVENT;
+				}
+
+				if(s_shift_keymap[scancode] == event) {
+					s_shift_keymap[scancode] = __LAST_EVENT;
+				}
+			}
+
+			rebound[event] = true;
+		}
+
+		bind_key(keymap, code, event);
+	}
+
+	fclose(file);
+
+	return valid;
+}
+
+
+const Settings* start_engine(int argc, char **argv) {
+	s_settings = parse_params(argc, argv);
+	assert(s_settings != NULL);
+
+	// the headless mode doesn't need any window
+	if(s_settings->leave || s_settings->headless > 0) {
 		return s_settings;
 	}
 
@@ -699,6 +1922,14 @@ const Settings* start_engine(int argc, char **argv) {
 		return s_settings;
 	}
 
+	s_engine.start_counter = SDL_GetPerformanceCounter();
+	s_engine.built_tetri = -1;
+
+	if(!s_settings->vsync && s_settings->framerate > 0) {
+		s_engine.frame_period = SDL_GetPerformanceFrequency() / (Uint64) s_settings->framerate;
+		s_engine.frame_deadline = s_engine.start_counter + s_engine.frame_period;
+	}
+
 	/*
 	 * create main window, then create main window's renderer
 	 */
@@ -719,44 +1950,53 @@ const Settings* start_engine(int argc, char **argv) {
 		return s_settings;
 	}
 
+	clear_inputs(&s_inputs);
+	init_autoshift(&s_shift, s_settings->das, s_settings->arr, s_settings->blocks_per_row);
+	for(int code = 0; code < SDL_NUM_SCANCODES; code++) {
+		s_held[code] = __LAST_EVENT;
+	}
+
 	/*
-	 * set the keycodes
+	 * bind the keys
 	 */
 
-	// universal key controls
-	s_keys[DELETE_EVENT] = SDLK_d;
-	s_keys[DROP_EVENT] = SDLK_SPACE;
-	s_keys[EXIT_EVENT] = SDLK_ESCAPE;
-	s_keys[PAUSE_EVENT] = SDLK_p;
+	set_default_keymap();
 
-	if(s_settings->vi_mode) {
-		s_keys[LEFT_EVENT] = SDLK_s;
-		s_keys[RIGHT_EVENT] = SDLK_l;
-		s_keys[NEWGAME_EVENT] = SDLK_RETURN;
-		s_keys[ROTATE_CLOCKWS_EVENT] = SDLK_f;
-		s_keys[ROTATE_COUNTERCLOCKWS_EVENT] = SDLK_j;
-		s_keys[SHIFT_EVENT] = SDLK_k;
-	} else {
-		s_keys[LEFT_EVENT] = SDLK_LEFT;
-		s_keys[RIGHT_EVENT] = SDLK_RIGHT;
-		s_keys[NEWGAME_EVENT] = SDLK_n;
-		s_keys[ROTATE_CLOCKWS_EVENT] = SDLK_DOWN;
-		s_keys[ROTATE_COUNTERCLOCKWS_EVENT] = SDLK_UP;
-		s_keys[SHIFT_EVENT] = SDLK_DOWN;
+	if(s_settings->keymap != NULL && !load_keymap(s_settings->keymap)) {
+		s_settings->leave = true;
+		return s_settings;
 	}
 
-	return s_settings;
-}
+	// the keys injected are found in the keymap, so that they go through receive_events like the others
+	if(s_settings->inject > 0) {
+		s_engine.inject_keys[0] = SDL_SCANCODE_UNKNOWN;
+		s_engine.inject_keys[1] = SDL_SCANCODE_UNKNOWN;
 
+		for(int code = 0; code < SDL_NUM_SCANCODES; code++) {
+			if(s_keymap[code] == LEFT_EVENT && s_engine.inject_keys[0] == SDL_SCANCODE_UNKNOWN) {
+				s_engine.inject_keys[0] = (SDL_Scancode) code;
+			} else if(s_keymap[code] == RIGHT_EVENT && s_engine.inject_keys[1] == SDL_SCANCODE_UNKNOWN) {
+				s_engine.inject_keys[1] = (SDL_Scancode) code;
+			}
+		}
 
-void stop_engine(void) {
+		if(s_engine.inject_keys[0] == SDL_SCANCODE_UNKNOWN || s_engine.inject_keys[1] == SDL_SCANCODE_UNKNOWN) {
+			fprintf(stderr, "Couldn't find the left and right keys to inject!\n");
+			s_settings->leave = true;
+			return s_settings;
+		}
 
-	/*
-	 * free grid memory
-	 */
-	
-	free_grid();
+		s_engine.next_inject = SDL_GetTicks() + INJECT_PERIOD;
+	}
+
+	return s_settings;
+}
 
+
+/*
+ * free every SDL resource loaded by start_engine
+ */
+static void stop_sdl(void) {
 	/*
 	 * free loaded fonts
 	 */
@@ -766,16 +2006,51 @@ void stop_engine(void) {
 	TTF_CloseFont(s_engine.font); s_engine.font = NULL;
 
 	/*
-	 * free loaded blocks image file and background image file
+	 * free the atlas, the batch and the background image file
 	 */
 
-	assert(s_engine.blocks != NULL);
-	SDL_DestroyTexture(s_engine.blocks); s_engine.blocks = NULL;
+	assert(s_engine.atlas != NULL || s_engine.atlas_image != NULL);
+
+	if(s_engine.atlas != NULL) {
+		SDL_DestroyTexture(s_engine.atlas); s_engine.atlas = NULL;
+	}
+
+	free(s_engine.vertices); s_engine.vertices = NULL;
+	free(s_engine.indices); s_engine.indices = NULL;
+	s_engine.quads = 0; s_engine.max_quads = 0;
+
+	free(s_engine.drawn_vertices); s_engine.drawn_vertices = NULL;
+	free(s_engine.drawn_rows); s_engine.drawn_rows = NULL;
 
 	if(s_engine.background != NULL) {
 		SDL_DestroyTexture(s_engine.background); s_engine.background = NULL;
 	}
 
+	if(s_engine.locked != NULL) {
+		SDL_DestroyTexture(s_engine.locked); s_engine.locked = NULL;
+	}
+
+	/*
+	 * free the images of the raster backend
+	 */
+
+	Image **images[] = {&(s_engine.background_image), &(s_engine.atlas_image),
+		&(s_engine.locked_image), &(s_engine.frame_image)};
+
+	for(int index = 0; index < 4; index++) {
+		if(*images[index] != NULL) {
+			destroy_image(*images[index]); *images[index] = NULL;
+		}
+	}
+
+	if(s_engine.frame != NULL) {
+		SDL_DestroyTexture(s_engine.frame); s_engine.frame = NULL;
+	}
+
+	if(s_engine.offscreen != NULL) {
+		SDL_DestroyTexture(s_engine.offscreen); s_engine.offscreen = NULL;
+	}
+
 	/*
 	 * destroy the main window and its renderer
 	 */
@@ -793,6 +2068,49 @@ void stop_engine(void) {
 	TTF_Quit();
 	IMG_Quit();
 	SDL_Quit();
+}
+
+
+/*
+ * print the percentiles of the durations counted by histogram, name being what they are
+ */
+static void print_histogram(const Histogram *histogram, const char *name) {
+	assert(histogram != NULL);
+	assert(name != NULL);
+
+	if(histogram->count == 0) {
+		return;
+	}
+
+	static const int permilles[] = { 500, 900, 990, 999 };
+	const int count = (int) (sizeof(permilles) / sizeof(permilles[0]));
+
+	printf("%s: %u\n", name, histogram->count);
+
+	for(int percentile = 0; percentile < count; percentile++) {
+		printf("%.1f%% of the %s: %.2f ms or less\n", permilles[percentile] / 10.0, name,
+			(double) duration_percentile(histogram, permilles[percentile]) / 1000.0);
+	}
+
+	printf("longest of the %s: %.2f ms\n", name, (double) histogram->max / 1000.0);
+}
+
+
+void stop_engine(void) {
+	assert(s_settings != NULL);
+
+	if(s_settings->frame_stats) {
+		print_histogram(&(s_engine.frame_times), "frame times");
+	}
+
+	if(s_settings->latency_report) {
+		print_histogram(&(s_engine.latencies), "input latencies");
+	}
+
+	// in headless mode, SDL was never started
+	if(s_settings->headless == 0) {
+		stop_sdl();
+	}
 
 	/*
 	 * unset s_settings
@@ -801,6 +2119,15 @@ void stop_engine(void) {
 	s_settings = NULL;
 }
 
+void track_input(uint32_t time) {
+	assert(s_settings != NULL);
+
+	if(s_settings->latency_report && s_engine.tracked_count < MAX_TRACKED_INPUTS) {
+		s_engine.tracked_inputs[s_engine.tracked_count++] = time;
+	}
+}
+
+
 void trigger_exit(void) {
 	assert(s_settings != NULL);
 	assert(!s_settings->leave);
@@ -815,6 +2142,88 @@ void update_screen(void) {
 	assert(s_engine.window != NULL);
 	assert(s_engine.renderer != NULL);
 
-	SDL_RenderPresent(s_engine.renderer);
+	if(s_settings->capture != NULL) {
+		// the frame stays in the offscreen texture until the next one, for capture_screen
+		SDL_SetRenderTarget(s_engine.renderer, s_engine.offscreen);
+		draw_commands(NULL);
+		SDL_SetRenderTarget(s_engine.renderer, NULL);
+	} else if(!s_settings->dirty_rects) {
+		draw_commands(NULL);
+		SDL_RenderPresent(s_engine.renderer);
+	} else {
+		compute_damage();
+
+		if(s_engine.full_damage) {
+			draw_commands(NULL);
+			SDL_RenderFlush(s_engine.renderer);
+			SDL_UpdateWindowSurface(s_engine.window);
+		} else if(s_engine.damage_count > 0) {
+			for(int index = 0; index < s_engine.damage_count; index++) {
+				SDL_RenderSetClipRect(s_engine.renderer, s_engine.damage + index);
+				draw_commands(s_engine.damage + index);
+			}
+
+			SDL_RenderSetClipRect(s_engine.renderer, NULL);
+			SDL_RenderFlush(s_engine.renderer);
+			SDL_UpdateWindowSurfaceRects(s_engine.window, s_engine.damage, s_engine.damage_count);
+		} // else nothing changed, the window is already up to date
+
+		remember_frame();
+
+		s_engine.damage_count = 0;
+		s_engine.full_damage = false;
+	}
+
+	// the frame showing the inputs handled since the last one has been sent
+	if(s_settings->latency_report && s_engine.tracked_count > 0) {
+		Uint64 now = get_us();
+
+		for(int input = 0; input < s_engine.tracked_count; input++) {
+			Uint64 time = (Uint64) s_engine.tracked_inputs[input] * 1000;
+
+			s_engine.last_latency = now > time ? now - time : 0;
+			record_duration(&(s_engine.latencies), s_engine.last_latency);
+		}
+
+		s_engine.tracked_count = 0;
+	}
+
+	// start a new frame
+	s_engine.quads = 0;
+	s_engine.command_count = 0;
+	s_engine.built_tetri = -1;
 }
 
+
+void wait_frame(void) {
+	assert(s_settings != NULL);
+
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 now = SDL_GetPerformanceCounter();
+
+	if(s_engine.frame_period > 0) {
+		Uint64 spin = FRAME_SPIN_US * frequency / 1000000;
+
+		// sleep for most of the remaining time, then spin until the deadline
+		if(now + spin < s_engine.frame_deadline) {
+			SDL_Delay((Uint32) ((s_engine.frame_deadline - now - spin) * 1000 / frequency));
+		}
+
+		do {
+			now = SDL_GetPerformanceCounter();
+		} while(now < s_engine.frame_deadline);
+
+		// after a late frame, the next ones aren't shortened to catch up
+		if(now - s_engine.frame_deadline > s_engine.frame_period) {
+			s_engine.frame_deadline = now;
+		}
+
+		s_engine.frame_deadline += s_engine.frame_period;
+	}
+
+	if(s_engine.frame_end != 0) {
+		record_duration(&(s_engine.frame_times), (now - s_engine.frame_end) * 1000000 / frequency);
+	}
+
+	s_engine.frame_end = now;
+}
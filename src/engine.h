@@ -2,29 +2,15 @@
 #ifndef H_ENGINE
 #define H_ENGINE
 
+#include "game.h"
 #include "tetri.h"
 #include "grid.h"
+#include "input.h"
 #include "param.h"
 
 #include <limits.h>
 #include <stdint.h>
 
-typedef enum {
-	DELETE_EVENT,
-	DROP_EVENT,
-	EXIT_EVENT,
-	FOCUSGAINED_EVENT,
-	FOCUSLOST_EVENT,
-	LEFT_EVENT,
-	NEWGAME_EVENT,
-	PAUSE_EVENT,
-	RIGHT_EVENT,
-	ROTATE_CLOCKWS_EVENT,
-	ROTATE_COUNTERCLOCKWS_EVENT,
-	SHIFT_EVENT,
-	__LAST_EVENT
-} Event;
-
 typedef enum {
 	YELLOW = 0,
 	RED,
@@ -38,6 +24,13 @@ typedef enum {
 } Colors;
 
 
+/*
+ * in capture mode, save the last frame drawn to filename
+ * as a png image if filename ends with ".png", else as raw ARGB8888 pixels in native byte order
+ * return false if the image couldn't be saved
+ */
+bool capture_screen(const char *filename);
+
 /*
  * fill screen with a color or a background image if it is loaded
  */
@@ -48,10 +41,16 @@ void clear_screen(void);
  */
 void draw_preview(Tetri *tetri);
 
+/*
+ * draw everything the game state holds at time now, update_screen sends the frame
+ * the current tetri is drawn as far to the next row as the delay before moving it down has passed
+ */
+void draw_game(const GameState *game, uint32_t now);
+
 /*
  * draw the entire grid
  */
-void draw_grid(void);
+void draw_grid(const Grid *grid);
 
 /*
  * darken the screen and display the pause text
@@ -76,26 +75,32 @@ void draw_statistics(int level, int rows);
 void draw_tetri(Tetri *tetri, int opacity);
 
 /*
- * get the number of milliseconds since the engine is started
+ * get the number of microseconds since the engine is started
  */
-uint32_t get_ms(void);
+uint64_t get_us(void);
 
 /*
- * pause the game during ms microseconds
- * this is not a user-triggered pause!
+ * after draw_game and before update_screen, draw the frame again for game, which changed in between
+ * if only the current tetri changed, only its blocks (and its fallen position) are drawn again
  */
-void pause_engine(uint32_t ms);
+void redraw_tetri(const GameState *game, uint32_t now);
 
 /*
  * check for user input (key pressed, button clicked)
- * then update the array of events
- * return the address of a static array of events
- * if no event was received, return NULL
+ * then push each action at the end of a static queue, in order, timed like get_us (in ms)
+ * return the address of the queue, from which the caller pops the inputs it handles
  */
-const bool* receive_events(void);
+InputQueue* receive_events(void);
+
+/*
+ * tell that a new tetri appeared at time, so that auto-shift with an arr of 0 shifts it against the wall too
+ * the moves are pushed into the queue of receive_events
+ */
+void shift_new_tetri(uint32_t time);
 
 /*
  * create a window, open needed files
+ * in headless mode, only parse the settings
  */
 const Settings* start_engine(int argc, char **argv);
 
@@ -105,6 +110,12 @@ const Settings* start_engine(int argc, char **argv);
  */
 void stop_engine(void);
 
+/*
+ * with settings->latency_report, record that an input which happened at time (like receive_events)
+ * has been handled: its latency is measured when the next frame is sent by update_screen
+ */
+void track_input(uint32_t time);
+
 /*
  * set settings->leave to true
  */
@@ -115,4 +126,11 @@ void trigger_exit(void);
  */
 void update_screen(void);
 
+/*
+ * wait until the next frame must be started, according to settings->framerate
+ * unless the frames are paced by vsync or uncapped (framerate 0)
+ * then record the time since the previous call for settings->frame_stats
+ */
+void wait_frame(void);
+
 #endif
@@ -0,0 +1,288 @@
+
+/*
+ * game.c
+ *
+ * Copyright 2012 Bresson Matthieu <mbresson@etudiant.univ-mlv.fr>
+ *
+ * This file is part of Blockmatic.
+ *
+ * Blockmatic is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Blockmatic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULIAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Blockmatic. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "game.h"
+
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+GameState* create_game(const Settings *settings, uint32_t now) {
+	assert(settings != NULL);
+
+	GameState *state = malloc(sizeof(GameState));
+	if(!state) {
+		fprintf(stderr, "Couldn't allocate %zu bytes!\n", sizeof(GameState));
+		return NULL;
+	}
+
+	/*
+	 * allocate the whole grid
+	 * check if it's all right
+	 */
+
+	state->grid = create_grid(settings->blocks_per_col, settings->blocks_per_row);
+	if(!state->grid) {
+		free(state);
+		return NULL;
+	}
+
+	state->settings = settings;
+
+	seed_rng(&(state->rng), (uint64_t) settings->seed);
+	init_randomizer(&(state->randomizer), settings->randomizer, next_random(&(state->rng)));
+
+	state->last_time_movedown = now;
+	state->delay_until_movedown = (uint64_t) settings->duration << GRAVITY_SHIFT;
+	state->fall = 0;
+
+	state->last_time_decrease = now;
+	state->delay_until_decrease = (uint32_t) settings->delay;
+
+	state->pause = false;
+	state->keypause = false;
+
+	state->recycle = false;
+	state->newgame = true;
+
+	state->movedown = 0;
+
+	state->over = false;
+
+	state->completed_rows = 0;
+	state->level = 1;
+	state->level_rows = 0;
+
+	state->tetriminos = 0;
+	state->games = 0;
+
+	state->next = new_random_tetri(&(state->randomizer), settings);
+	state->tetri = new_random_tetri(&(state->randomizer), settings);
+
+	return state;
+}
+
+
+/*
+ * decrease the delay before moving down by settings->decrease percent, for the next level
+ * then start waiting for it from now
+ */
+static void decrease_delay(GameState *state) {
+	assert(state != NULL);
+
+	// the delay cannot reach 0 since decrease is below 100%
+	uint64_t drawback = state->delay_until_movedown * (uint64_t) state->settings->decrease / 100;
+	state->delay_until_movedown -= drawback;
+
+	state->fall = 0;
+}
+
+
+void destroy_game(GameState *state) {
+	assert(state != NULL);
+
+	destroy_grid(state->grid);
+	free(state);
+}
+
+
+void game_step(GameState *state, const bool *inputs, uint32_t now) {
+	assert(state != NULL);
+	assert(inputs != NULL);
+	assert(!state->over);
+
+	const Settings *settings = state->settings;
+	Grid *grid = state->grid;
+
+	// time doesn't make the tetri fall while the game is paused
+	if(!state->pause) {
+		state->fall += (uint64_t) (now - state->last_time_movedown) << GRAVITY_SHIFT;
+	}
+	state->last_time_movedown = now;
+
+	if(state->fall >= state->delay_until_movedown) {
+		uint64_t rows = state->fall / state->delay_until_movedown;
+		state->fall %= state->delay_until_movedown;
+
+		// it doesn't matter how far a tetri falls past the height of the grid
+		state->movedown = rows < (uint64_t) settings->blocks_per_col ? (int) rows : settings->blocks_per_col;
+	}
+
+	if(inputs[PAUSE_EVENT]) {
+		state->pause = !state->pause;
+		state->keypause = !state->keypause;
+	}
+
+	if(inputs[FOCUSLOST_EVENT]) {
+		state->pause = true;
+	}
+
+	if(inputs[FOCUSGAINED_EVENT] && !state->keypause) {
+		state->pause = false;
+	}
+
+	if(inputs[NEWGAME_EVENT]) {
+		state->newgame = true;
+	}
+
+	if(!state->pause && !state->newgame) {
+		if(inputs[LEFT_EVENT]) {
+			move_tetri(grid, &(state->tetri), LEFT_MOVE);
+		}
+
+		if(inputs[RIGHT_EVENT]) {
+			move_tetri(grid, &(state->tetri), RIGHT_MOVE);
+		}
+
+		if(inputs[DELETE_EVENT]) {
+			if(!empty_row(grid, settings->blocks_per_col - 1)) {
+				shift_grid(grid, settings->blocks_per_col-1);
+				state->completed_rows++;
+			}
+		}
+
+		if(inputs[DROP_EVENT]) {
+			state->tetri = find_fallen_position(grid, &(state->tetri));
+			state->recycle = true;
+		}
+
+		if(inputs[ROTATE_CLOCKWS_EVENT]) {
+			rotate_tetri(grid, &(state->tetri), CLOCKWISE_ROTATION);
+		}
+
+		if(inputs[ROTATE_COUNTERCLOCKWS_EVENT]) {
+			rotate_tetri(grid, &(state->tetri), COUNTERCLOCKWISE_ROTATION);
+		}
+
+		if(inputs[SHIFT_EVENT]) {
+			if(!move_tetri(grid, &(state->tetri), DOWN_MOVE)) {
+				state->recycle = true;
+			}
+		}
+
+		// then gravity, as many rows as the time passed
+		for(; state->movedown > 0 && !state->recycle; state->movedown--) {
+			if(!move_tetri(grid, &(state->tetri), DOWN_MOVE)) {
+				state->recycle = true;
+			}
+		}
+	}
+
+	// the rows due while paused or before a new game are not moved down later
+	state->movedown = 0;
+
+	// recycle?
+	if(state->recycle) {
+		freeze_tetri(grid, &(state->tetri));
+		state->tetriminos++;
+
+		state->tetri = state->next;
+		state->next = new_random_tetri(&(state->randomizer), settings);
+
+		if(!valid_position(grid, &(state->tetri))) {
+			if(settings->restart) {
+				state->newgame = true;
+			} else {
+				state->over = true;
+				return;
+			}
+		}
+
+		state->fall = 0;
+
+		state->recycle = false;
+	}
+
+	// detect and delete complete rows, including the ones the frozen tetri just completed
+	if(!state->pause && !state->newgame) {
+		int lines[MAX_CLEARED_LINES];
+		state->completed_rows += clear_lines(grid, lines);
+	}
+
+	// new game?
+	if(state->newgame) {
+		state->tetri = new_random_tetri(&(state->randomizer), settings);
+		state->next = new_random_tetri(&(state->randomizer), settings);
+		erase_grid(grid);
+
+		int start_row = settings->blocks_per_col - settings->rows;
+		for(int row = start_row; row < settings->blocks_per_col; row++) {
+			fill_row(grid, row, &(state->rng));
+		}
+
+		state->fall = 0;
+		state->delay_until_movedown = (uint64_t) settings->duration << GRAVITY_SHIFT;
+		state->completed_rows = 0;
+		state->level = 1;
+		state->level_rows = 0;
+		state->games++;
+
+		state->newgame = false;
+		state->pause = false;
+	}
+
+	// next level?
+	if(settings->usedelay && !state->pause) {
+		if(now - state->last_time_decrease >= (state->delay_until_decrease * 1000)) {
+			state->level++;
+
+			decrease_delay(state);
+
+			state->last_time_decrease = now;
+		}
+	} else {
+		if(state->completed_rows >= settings->threshold + state->level_rows) {
+			state->level_rows += settings->threshold;
+			state->level++;
+
+			decrease_delay(state);
+		}
+	}
+}
+
+
+void skip_game_time(GameState *state, uint32_t ms) {
+	assert(state != NULL);
+
+	state->last_time_movedown += ms;
+	state->last_time_decrease += ms;
+}
+
+
+int movedown_progress(const GameState *state, uint32_t now, int scale) {
+	assert(state != NULL);
+	assert(scale > 0);
+
+	uint64_t fall = state->fall;
+	if(!state->pause) {
+		fall += (uint64_t) (now - state->last_time_movedown) << GRAVITY_SHIFT;
+	}
+
+	if(fall >= state->delay_until_movedown) {
+		return scale;
+	}
+
+	return (int) (fall * (uint64_t) scale / state->delay_until_movedown);
+}
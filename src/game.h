@@ -0,0 +1,115 @@
+
+#ifndef H_GAME
+#define H_GAME
+
+#include "grid.h"
+#include "param.h"
+#include "rng.h"
+#include "tetri.h"
+
+#include <stdint.h>
+
+/*
+ * the delay before moving down is stored in fixed point, in units of 1 / 2^GRAVITY_SHIFT ms,
+ * so that it can keep decreasing level after level, far below 1 ms
+ */
+#define GRAVITY_SHIFT 16
+
+/*
+ * the inputs of a game step
+ * each one is either true or false depending on the user input (or the bot's)
+ */
+typedef enum {
+	DELETE_EVENT,
+	DROP_EVENT,
+	EXIT_EVENT,
+	FOCUSGAINED_EVENT,
+	FOCUSLOST_EVENT,
+	LEFT_EVENT,
+	NEWGAME_EVENT,
+	PAUSE_EVENT,
+	RIGHT_EVENT,
+	ROTATE_CLOCKWS_EVENT,
+	ROTATE_COUNTERCLOCKWS_EVENT,
+	SHIFT_EVENT,
+	__LAST_EVENT
+} Event;
+
+/*
+ * the whole state of a game
+ * it doesn't depend on SDL, so it can be used by the bot, benchmarks or any frontend
+ * times are in milliseconds, they can come from any clock
+ */
+typedef struct {
+	const Settings *settings;
+
+	Grid *grid;
+
+	// every random choice of the game derives from settings->seed
+	Rng rng;
+	Randomizer randomizer;
+
+	Tetri tetri, next;
+
+	/*
+	 * wait settings->duration ms before moving down, this number will decrease (in fixed point)
+	 * fall is the time (in fixed point) elapsed since the last move down, until last_time_movedown
+	 * it can hold the delay several times: then several rows are moved down at once
+	 */
+	uint32_t last_time_movedown;
+	uint64_t delay_until_movedown;
+	uint64_t fall;
+
+	// wait settings->delay ms before decreasing delay, if settings->usedelay
+	uint32_t last_time_decrease;
+	uint32_t delay_until_decrease;
+
+	// if keypause, the game was paused because P was pressed
+	bool pause, keypause;
+
+	// if recycle / newgame, require a new tetrimino / a new game
+	bool recycle, newgame;
+
+	// the number of rows to move the current tetrimino down
+	int movedown;
+
+	// if over, the game is lost and settings->restart is false
+	bool over;
+
+	// the number of completed rows and the level
+	int completed_rows, level, level_rows;
+
+	// the number of frozen tetriminos and the number of started games, since create_game
+	int tetriminos, games;
+} GameState;
+
+/*
+ * return a new game, which will really start at the first call to game_step
+ * return NULL if memory allocation failed
+ */
+GameState* create_game(const Settings *settings, uint32_t now);
+
+/*
+ * free a game created by create_game
+ */
+void destroy_game(GameState *state);
+
+/*
+ * process inputs (an array of __LAST_EVENT booleans), then let the time pass until now:
+ * move, rotate, freeze tetriminos, delete complete rows, go to the next level...
+ * EXIT_EVENT is ignored, leaving is up to the caller
+ */
+void game_step(GameState *state, const bool *inputs, uint32_t now);
+
+/*
+ * let ms pass without the game noticing: the tetri doesn't fall and the level doesn't change meanwhile
+ * the next steps must not happen before the time of the last one plus ms
+ */
+void skip_game_time(GameState *state, uint32_t ms);
+
+/*
+ * return how much of the delay before the next move down has passed, from 0 to scale
+ */
+int movedown_progress(const GameState *state, uint32_t now, int scale);
+
+#endif
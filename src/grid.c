@@ -27,88 +27,359 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
- * at runtime, this is a malloc-ed matrix
- * used to store the state of every case of the board
+ * the rows of a grid are aligned on this boundary,
+ * so that a standard 20-row board only spans 3 cache lines
  */
-static Case **s_grid;
+#define CACHE_LINE_SIZE 64
 
-static int s_blocks_per_col, s_blocks_per_row;
+/*
+ * a grid is a single malloc-ed block holding this struct,
+ * followed by the rows, then by the height of each column
+ * so copying a grid only requires copying this block
+ */
+struct Grid {
+	size_t size; // the size of the whole block
+
+	/*
+	 * used to store the state of every case of the board
+	 * rows are contiguous and cache-aligned, the top row is rows[0]
+	 */
+	Row *rows;
+
+	/*
+	 * the surface of the board: for each column,
+	 * the number of its highest filled row, or blocks_per_col if it is empty
+	 */
+	int *heights;
+
+	int blocks_per_col, blocks_per_row;
+
+	/*
+	 * the value of a row whose cases are all filled
+	 */
+	Row full_row;
+
+	/*
+	 * the only rows which may have been completed since complete_line last returned -1:
+	 * the ones covered by the last frozen tetri or by a filled row
+	 * if check_top > check_bottom, there is nothing to check
+	 */
+	int check_top, check_bottom;
+
+	/*
+	 * incremented every time the cases change, see get_grid_version
+	 */
+	unsigned int version;
+};
+
+
+static inline void clear_check_window(Grid *grid) {
+	grid->check_top = grid->blocks_per_col;
+	grid->check_bottom = -1;
+}
 
 
-int complete_line(void) {
-	assert(s_grid != NULL);
+/*
+ * rebuild grid->heights from the rows, starting at row top
+ * every row above top must be empty
+ */
+static void compute_heights(Grid *grid, int top) {
+	for(int x = 0; x < grid->blocks_per_row; x++) {
+		grid->heights[x] = grid->blocks_per_col;
+	}
+
+	Row seen = 0;
 
-	for(int y = s_blocks_per_col - 1; y >= 0; y--) {
-		int counter = 0;
-		for(int x = s_blocks_per_row - 1; x >= 0; x--) {
-			if(s_grid[y][x] == FILLED_CASE) {
-				counter++;
+	for(int y = top; y < grid->blocks_per_col && seen != grid->full_row; y++) {
+		Row uncovered = grid->rows[y] & ~seen;
+
+		for(int x = 0; uncovered != 0; x++, uncovered >>= 1) {
+			if(uncovered & 1) {
+				grid->heights[x] = y;
 			}
 		}
 
-		if(counter == s_blocks_per_row) {
-			return y;
+		seen |= grid->rows[y];
+	}
+}
+
+
+/*
+ * return the number of the highest filled row of the whole board
+ */
+static inline int surface_top(const Grid *grid) {
+	int top = grid->blocks_per_col;
+
+	for(int x = 0; x < grid->blocks_per_row; x++) {
+		if(grid->heights[x] < top) {
+			top = grid->heights[x];
 		}
 	}
 
-	return -1;
+	return top;
 }
 
 
-bool empty_row(int row) {
-	assert(s_grid != NULL);
-	assert(row >= 0 && row < s_blocks_per_col);
+static inline void extend_check_window(Grid *grid, int top, int bottom) {
+	assert(top <= bottom);
 
-	bool empty = true;
-	
-	for(int x = 0; x < s_blocks_per_row; x++) {
-		if(s_grid[row][x] == FILLED_CASE) {
-			empty = false;
-			break;
+	if(top < grid->check_top) {
+		grid->check_top = top;
+	}
+
+	if(bottom > grid->check_bottom) {
+		grid->check_bottom = bottom;
+	}
+}
+
+
+/*
+ * set the rows and heights pointers of a freshly allocated grid
+ * the rows start on the first cache line boundary after the struct itself
+ */
+static inline void layout_grid(Grid *grid) {
+	uintptr_t address = (uintptr_t) (grid + 1);
+	address = (address + CACHE_LINE_SIZE - 1) & ~((uintptr_t) CACHE_LINE_SIZE - 1);
+
+	grid->rows = (Row*) address;
+	grid->heights = (int*) (grid->rows + grid->blocks_per_col);
+}
+
+
+int clear_lines(Grid *grid, int lines[MAX_CLEARED_LINES]) {
+	assert(grid != NULL);
+	assert(lines != NULL);
+
+	/*
+	 * complete rows can only be found in the check window:
+	 * inside it, incomplete rows are compacted towards the bottom,
+	 * then the rows above it move down at once
+	 */
+
+	int count = 0;
+	int dest = grid->check_bottom;
+
+	for(int y = grid->check_bottom; y >= grid->check_top; y--) {
+		if(grid->rows[y] == grid->full_row) {
+			assert(count < MAX_CLEARED_LINES);
+			lines[count++] = y;
+		} else {
+			grid->rows[dest--] = grid->rows[y];
 		}
 	}
 
-	return empty;
+	if(count > 0) {
+		int top = surface_top(grid);
+
+		memmove(grid->rows + count, grid->rows, sizeof(Row) * (size_t) grid->check_top);
+		memset(grid->rows, 0, sizeof(Row) * (size_t) count);
+
+		// the surface can only have moved down
+		compute_heights(grid, top);
+
+		grid->version++;
+	}
+
+	clear_check_window(grid);
+
+	return count;
+}
+
+
+Grid* clone_grid(const Grid *grid) {
+	assert(grid != NULL);
+
+	Grid *clone = (Grid*) malloc(grid->size);
+	if(!clone) {
+		fprintf(stderr, "Couldn't allocate %zu bytes!\n", grid->size);
+		return NULL;
+	}
+
+	*clone = *grid;
+	layout_grid(clone);
+
+	// the padding before the rows may differ from one block to another
+	size_t size_of_cases = sizeof(Row) * (size_t) grid->blocks_per_col
+		+ sizeof(int) * (size_t) grid->blocks_per_row;
+
+	memcpy(clone->rows, grid->rows, size_of_cases);
+
+	return clone;
+}
+
+
+void copy_grid(Grid *dest, const Grid *src) {
+	assert(dest != NULL);
+	assert(src != NULL);
+	assert(dest->blocks_per_col == src->blocks_per_col);
+	assert(dest->blocks_per_row == src->blocks_per_row);
+
+	size_t size_of_cases = sizeof(Row) * (size_t) src->blocks_per_col
+		+ sizeof(int) * (size_t) src->blocks_per_row;
+
+	memcpy(dest->rows, src->rows, size_of_cases);
+
+	dest->check_top = src->check_top;
+	dest->check_bottom = src->check_bottom;
+
+	dest->version++;
 }
 
 
-void erase_grid(void) {
-	assert(s_grid != NULL);
+int complete_line(Grid *grid) {
+	assert(grid != NULL);
 
-	for(int y = 0; y < s_blocks_per_col; y++) {
-		for(int x = 0; x < s_blocks_per_row; x++) {
-			s_grid[y][x] = EMPTY_CASE;
+	for(int y = grid->check_bottom; y >= grid->check_top; y--) {
+		if(grid->rows[y] == grid->full_row) {
+			// the rows below have just been checked
+			grid->check_bottom = y;
+			return y;
 		}
 	}
+
+	clear_check_window(grid);
+
+	return -1;
+}
+
+
+/*
+ * a row is a single bitmask, so the whole grid is a single block:
+ * the Grid struct, then a cache-aligned array of rows,
+ * then the height of each column
+ */
+Grid* create_grid(int blocks_per_col, int blocks_per_row) {
+	assert(blocks_per_col > 0);
+	assert(blocks_per_row > 0 && blocks_per_row <= MAX_BLOCKS_PER_ROW);
+
+	size_t size_of_grid = sizeof(Grid) + CACHE_LINE_SIZE - 1
+		+ sizeof(Row) * (size_t) blocks_per_col
+		+ sizeof(int) * (size_t) blocks_per_row;
+
+	Grid *grid = (Grid*) malloc(size_of_grid);
+	if(!grid) {
+		fprintf(stderr, "Couldn't allocate %zu bytes!\n", size_of_grid);
+		return NULL;
+	}
+
+	grid->size = size_of_grid;
+	grid->version = 0;
+	grid->blocks_per_row = blocks_per_row;
+	grid->blocks_per_col = blocks_per_col;
+
+	layout_grid(grid);
+
+	// shifting a 64-bit value by 64 is undefined, hence the special case
+	if(blocks_per_row == MAX_BLOCKS_PER_ROW) {
+		grid->full_row = ~(Row) 0;
+	} else {
+		grid->full_row = ((Row) 1 << blocks_per_row) - 1;
+	}
+
+	erase_grid(grid);
+
+	return grid;
+}
+
+
+void destroy_grid(Grid *grid) {
+	assert(grid != NULL);
+
+	free(grid);
+}
+
+
+bool empty_row(const Grid *grid, int row) {
+	assert(grid != NULL);
+	assert(row >= 0 && row < grid->blocks_per_col);
+
+	return grid->rows[row] == 0;
 }
 
 
-void fill_row(int row) {
-	assert(s_grid != NULL);
-	assert(row > 3 && row < s_blocks_per_col);
+void erase_grid(Grid *grid) {
+	assert(grid != NULL);
+
+	memset(grid->rows, 0, sizeof(Row) * (size_t) grid->blocks_per_col);
+
+	for(int x = 0; x < grid->blocks_per_row; x++) {
+		grid->heights[x] = grid->blocks_per_col;
+	}
+
+	clear_check_window(grid);
+
+	grid->version++;
+}
+
+
+void fill_row(Grid *grid, int row, Rng *rng) {
+	assert(grid != NULL);
+	assert(rng != NULL);
+	assert(row > 3 && row < grid->blocks_per_col);
 
 	int filled_blocks = 0;
 
-	for(int block = 0; block < s_blocks_per_row; block++) {
-		if(rand() % 2 == 0) {
-			if(filled_blocks < s_blocks_per_row-1) {
+	// one random bit per block
+	Row random = next_random(rng);
+
+	for(int block = 0; block < grid->blocks_per_row; block++) {
+		if((random >> block & 1) == 0) {
+			if(filled_blocks < grid->blocks_per_row-1) {
 				filled_blocks++;
-				s_grid[row][block] = FILLED_CASE;
+				grid->rows[row] |= (Row) 1 << block;
+
+				if(row < grid->heights[block]) {
+					grid->heights[block] = row;
+				}
 			}
 		}
 	}
+
+	extend_check_window(grid, row, row);
+
+	grid->version++;
 }
 
 
-Tetri find_fallen_position(Tetri *const tetri) {
-	assert(s_grid != NULL);
+Tetri find_fallen_position(const Grid *grid, Tetri *const tetri) {
+	assert(grid != NULL);
 	assert(tetri != NULL);
 
+	const Shape *shape = tetri->shape;
+
 	Tetri tmp = *tetri;
 
-	while(valid_position(&tmp)) {
+	/*
+	 * if every block of tetri is above the surface of its column,
+	 * tetri can fall until one of its blocks lands on that surface
+	 */
+
+	int distance = grid->blocks_per_col;
+	bool above_surface = true;
+
+	for(int block = 0; block < 4 && above_surface; block++) {
+		int x = tetri->px + shape->x[block];
+		int y = tetri->py + shape->y[block];
+
+		assert(x >= 0 && x < grid->blocks_per_row);
+
+		if(y >= grid->heights[x]) {
+			above_surface = false;
+		} else if(grid->heights[x] - 1 - y < distance) {
+			distance = grid->heights[x] - 1 - y;
+		}
+	}
+
+	if(above_surface) {
+		tmp.py += distance;
+		return tmp;
+	}
+
+	// tetri is below an overhang, it must go down step by step
+	while(valid_position(grid, &tmp)) {
 		tmp.py++;
 	}
 
@@ -119,122 +390,116 @@ Tetri find_fallen_position(Tetri *const tetri) {
 }
 
 
-void free_grid(void) {
-	assert(s_grid != NULL);
+void freeze_tetri(Grid *grid, Tetri *tetri) {
+	assert(grid != NULL);
+	assert(tetri != NULL);
 
-	for(int row = 0; row < s_blocks_per_col; row++) {
-		assert(s_grid[row] != NULL);
-		
-		free(s_grid[row]);
-	}
+	const Shape *shape = tetri->shape;
 
-	free(s_grid);
-}
+	int left = tetri->px + shape->mask_x;
+	int top = tetri->py + shape->mask_y;
 
-void freeze_tetri(Tetri *tetri) {
-	assert(tetri != NULL);
-	assert(s_grid != NULL);
+	assert(left >= 0 && left + shape->width <= grid->blocks_per_row);
+	assert(top >= 0 && top + shape->height <= grid->blocks_per_col);
 
-	for(int block = 0; block < 4; block++) {
-		int tmp_x = tetri->x[block] + tetri->px;
-		int tmp_y = tetri->y[block] + tetri->py;
+	for(int row = 0; row < shape->height; row++) {
+		grid->rows[top + row] |= (Row) shape->mask[row] << left;
+	}
 
-		assert(tmp_x < s_blocks_per_row);
-		assert(tmp_y < s_blocks_per_col);
-		assert(s_grid[tmp_y] != NULL);
+	for(int block = 0; block < 4; block++) {
+		int x = tetri->px + shape->x[block];
+		int y = tetri->py + shape->y[block];
 
-		s_grid[tmp_y][tmp_x] = FILLED_CASE;
+		if(y < grid->heights[x]) {
+			grid->heights[x] = y;
+		}
 	}
+
+	extend_check_window(grid, top, top + shape->height - 1);
+
+	grid->version++;
 }
 
 
-const Case** get_grid(void) {
-	assert(s_grid != NULL);
+void get_grid_size(const Grid *grid, int *blocks_per_col, int *blocks_per_row) {
+	assert(grid != NULL);
+	assert(blocks_per_col != NULL);
+	assert(blocks_per_row != NULL);
 
-	return (const Case**) s_grid;
+	*blocks_per_col = grid->blocks_per_col;
+	*blocks_per_row = grid->blocks_per_row;
 }
 
 
-/*
- * this function must be called after every other initialization has been made
- * first it mallocs each column as an array of pointers to arrays of Case
- * then it mallocs each of these arrays of Case
- */
-bool init_grid(int blocks_per_col, int blocks_per_row) {
-	assert(!s_grid);
+unsigned int get_grid_version(const Grid *grid) {
+	assert(grid != NULL);
 
-	assert(blocks_per_col > 0);
-	assert(blocks_per_row > 0);
+	return grid->version;
+}
 
-	size_t size_of_col = sizeof(Case*);
-	size_t size_of_row = sizeof(Case) * (size_t) blocks_per_row;
 
-	s_grid = (Case**) malloc(size_of_col * (size_t) blocks_per_col);
-	if(!s_grid) {
-		fprintf(stderr, "Couldn't allocate %zu bytes!\n", size_of_col);
-		return false;
-	}
+const int* get_heights(const Grid *grid) {
+	assert(grid != NULL);
 
-	for(int row = 0; row < blocks_per_col; row++) {
-		s_grid[row] = (Case*) malloc(size_of_row);
-		if(!s_grid[row]) {
-			fprintf(stderr, "Couldn't allocate %zu bytes!\n", size_of_row);
-			return false;
-		}
+	return grid->heights;
+}
 
-		for(int row_case = 0; row_case < blocks_per_row; row_case++) {
-			s_grid[row][row_case] = EMPTY_CASE;
-		}
-	}
 
-	s_blocks_per_row = blocks_per_row;
-	s_blocks_per_col = blocks_per_col;
+const Row* get_rows(const Grid *grid) {
+	assert(grid != NULL);
 
-	return true;
+	return grid->rows;
 }
 
 
-void shift_grid(int line) {
-	assert(s_grid != NULL);
-	assert(line > 0 && line < s_blocks_per_col);
+void shift_grid(Grid *grid, int line) {
+	assert(grid != NULL);
+	assert(line > 0 && line < grid->blocks_per_col);
 
-	Case *last = s_grid[line];
+	int top = surface_top(grid);
 
-	// from s_grid[line] to the upper lines
-	for(int y = line; y > 0; y--) {
-		s_grid[y] = s_grid[y - 1];
-	}
+	// from rows[line] to the upper lines
+	memmove(grid->rows + 1, grid->rows, sizeof(Row) * (size_t) line);
+
+	grid->rows[0] = 0;
+
+	compute_heights(grid, top);
+
+	// the rows above line have moved down
+	if(grid->check_top <= grid->check_bottom) {
+		if(grid->check_top < line) {
+			grid->check_top++;
+		}
 
-	s_grid[0] = last;
-	for(int x = 0; x < s_blocks_per_row; x++) {
-		s_grid[0][x] = EMPTY_CASE;
+		if(grid->check_bottom < line) {
+			grid->check_bottom++;
+		}
 	}
+
+	grid->version++;
 }
 
 
-bool valid_position(Tetri *tetri) {
+bool valid_position(const Grid *grid, Tetri *tetri) {
+	assert(grid != NULL);
 	assert(tetri != NULL);
-	assert(s_grid != NULL);
 
-	bool result = true;
+	const Shape *shape = tetri->shape;
 
-	for(int block = 0; block < 4; block++) {
-		int tmp_x = tetri->x[block] + tetri->px;
-		int tmp_y = tetri->y[block] + tetri->py;
+	int left = tetri->px + shape->mask_x;
+	int top = tetri->py + shape->mask_y;
 
-		// first, we check if tetri is out of the grid
-		if(tmp_x < 0 || tmp_x >= s_blocks_per_row || tmp_y < 0 || tmp_y >= s_blocks_per_col) {
-			result = false;
-			break;
-		}
+	// first, we check if tetri is out of the grid
+	if(left < 0 || left + shape->width > grid->blocks_per_row || top < 0 || top + shape->height > grid->blocks_per_col) {
+		return false;
+	}
 
-		// then we check if there is a non-empty case at grid[tmp_y][tmp_x]
-		assert(s_grid[tmp_y] != NULL);
-		if(s_grid[tmp_y][tmp_x] == FILLED_CASE) {
-			result = false;
-			break;
+	// then we check if any row of tetri overlaps a filled case
+	for(int row = 0; row < shape->height; row++) {
+		if(grid->rows[top + row] & ((Row) shape->mask[row] << left)) {
+			return false;
 		}
 	}
 
-	return result;
+	return true;
 }
@@ -3,74 +3,128 @@
 #define H_GRID
 
 #include "tetri.h"
+#include "rng.h"
 
-typedef enum {
-	EMPTY_CASE = 0,
-	FILLED_CASE
-} Case;
+#include <stdint.h>
 
+/*
+ * a single tetri cannot complete more than 4 lines at once
+ */
+#define MAX_CLEARED_LINES 4
+
+/*
+ * each row of the grid is stored as a bitmask:
+ * bit x is set if the case at column x is filled
+ * this is why blocks_per_row cannot exceed MAX_BLOCKS_PER_ROW
+ */
+typedef uint64_t Row;
+
+/*
+ * a board of blocks_per_col rows
+ * every function of this module works on the grid it is given,
+ * so several grids can be used at the same time, in different threads if needed
+ */
+typedef struct Grid Grid;
+
+
+/*
+ * delete every complete line and push the other ones down, in a single pass
+ * the numbers the deleted lines had before deletion are stored in lines, from the bottom
+ * return the number of deleted lines
+ */
+int clear_lines(Grid *grid, int lines[MAX_CLEARED_LINES]);
 
 /*
- * return the number of the first complete line found
+ * return a copy of grid, to be destroyed with destroy_grid
+ * return NULL if memory allocation failed
+ */
+Grid* clone_grid(const Grid *grid);
+
+/*
+ * copy the state of src into dest, which must have the same size
+ * this is cheaper than clone_grid when a scratch grid is reused
+ */
+void copy_grid(Grid *dest, const Grid *src);
+
+/*
+ * return the number of the first complete line found, starting from the bottom
+ * only the rows modified since the last call returning -1 are checked
  * if no line is complete, return -1
  */
-int complete_line(void);
+int complete_line(Grid *grid);
+
+/*
+ * malloc enough memory to hold a grid of blocks_per_col rows
+ * return NULL if memory allocation failed
+ */
+Grid* create_grid(int blocks_per_col, int blocks_per_row);
 
 /*
- * if there is no FILLED_CASE in row, return true
+ * free malloc-ed grid
+ */
+void destroy_grid(Grid *grid);
+
+/*
+ * if there is no filled case in row, return true
  * else return false
  */
-bool empty_row(int row);
+bool empty_row(const Grid *grid, int row);
 
 /*
- * set all grid case to EMPTY_CASE
+ * empty all grid cases
  * used when restarting a game
  */
-void erase_grid(void);
+void erase_grid(Grid *grid);
 
 /*
- * fill row incompletely and randomly
+ * fill row incompletely and randomly, using rng
  */
-void fill_row(int row);
+void fill_row(Grid *grid, int row, Rng *rng);
 
 /*
  * find the position of the current tetri when it will have fallen
+ * the height of each column is used unless tetri is below an overhang
  */
-Tetri find_fallen_position(Tetri *const tetri);
+Tetri find_fallen_position(const Grid *grid, Tetri *const tetri);
 
 /*
- * free malloc-ed grid
- * called by start_engine
+ * append tetri to the grid
  */
-void free_grid(void);
+void freeze_tetri(Grid *grid, Tetri *tetri);
 
 /*
- * append tetri to the grid
+ * store the number of rows and columns of grid in blocks_per_col and blocks_per_row
+ */
+void get_grid_size(const Grid *grid, int *blocks_per_col, int *blocks_per_row);
+
+/*
+ * return a number which changes every time a case of grid is filled or emptied
+ * anything computed from the cases (a drawing, for example) is valid as long as it doesn't change
  */
-void freeze_tetri(Tetri *tetri);
+unsigned int get_grid_version(const Grid *grid);
 
 /*
- * return a pointer to s_grid
+ * return the surface of grid, an array of blocks_per_row numbers:
+ * for each column, the number of its highest filled row, or blocks_per_col if it is empty
  */
-const Case** get_grid(void);
+const int* get_heights(const Grid *grid);
 
 /*
- * malloc enough memory to hold a grid of blocks_per_col * blocks_per_row int objects
- * return false if memory allocation failed
+ * return the rows of grid, an array of blocks_per_col rows
  */
-bool init_grid(int blocks_per_col, int blocks_per_row);
+const Row* get_rows(const Grid *grid);
 
 /*
  * called when a line is complete
  * delete the line and push the other ones
  */
-void shift_grid(int line);
+void shift_grid(Grid *grid, int line);
 
 /*
  * if tetri is (partly) out of the grid
  * or on a non-empty case,
  * return false
  */
-bool valid_position(Tetri *tetri);
+bool valid_position(const Grid *grid, Tetri *tetri);
 
 #endif
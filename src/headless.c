@@ -0,0 +1,147 @@
+
+/*
+ * headless.c
+ *
+ * Copyright 2012 Bresson Matthieu <mbresson@etudiant.univ-mlv.fr>
+ *
+ * This file is part of Blockmatic.
+ *
+ * Blockmatic is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Blockmatic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULIAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Blockmatic. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "headless.h"
+
+#include "bot.h"
+#include "game.h"
+#include "grid.h"
+#include "tetri.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+/*
+ * bring tetri to the orientation and the column of target
+ * the way a player would do it, one rotation or one move at a time
+ */
+static void steer_tetri(const Grid *grid, Tetri *tetri, const Tetri *target) {
+	assert(tetri != NULL);
+	assert(target != NULL);
+
+	// counter-clockwise rotations increase the orientation, clockwise ones decrease it
+	int turns = ((int) target->orientation - (int) tetri->orientation + __LAST_ORIENTED) % __LAST_ORIENTED;
+	Rotation rotation = COUNTERCLOCKWISE_ROTATION;
+
+	if(turns == 3) {
+		turns = 1;
+		rotation = CLOCKWISE_ROTATION;
+	}
+
+	for(int turn = 0, falls = 0; turn < turns && falls < 4; ) {
+		Orientation orientation = tetri->orientation;
+
+		rotate_tetri(grid, tetri, rotation);
+
+		if(tetri->orientation != orientation) {
+			turn++;
+		} else if(move_tetri(grid, tetri, DOWN_MOVE)) {
+			// too close to the top of the grid, let it fall a bit before trying again
+			falls++;
+		} else {
+			break;
+		}
+	}
+
+	while(tetri->px != target->px) {
+		int px = tetri->px;
+
+		move_tetri(grid, tetri, tetri->px < target->px ? RIGHT_MOVE : LEFT_MOVE);
+
+		// something is in the way
+		if(tetri->px == px) {
+			break;
+		}
+	}
+}
+
+
+int run_headless(const Settings *settings) {
+	assert(settings != NULL);
+	assert(settings->headless > 0);
+
+	/*
+	 * time doesn't pass in headless mode:
+	 * tetriminos never fall by themselves, they are only dropped by the bot
+	 */
+
+	GameState *game = create_game(settings, 0);
+	Grid *scratch = create_grid(settings->blocks_per_col, settings->blocks_per_row);
+	if(!game || !scratch) {
+		if(game != NULL) {
+			destroy_game(game);
+		}
+
+		if(scratch != NULL) {
+			destroy_grid(scratch);
+		}
+
+		return EXIT_FAILURE;
+	}
+
+	bool inputs[__LAST_EVENT] = { false };
+
+	// the first step starts the game
+	game_step(game, inputs, 0);
+
+	// game->completed_rows is reset by every new game
+	int completed_rows = 0;
+
+	clock_t start = clock();
+
+	while(game->tetriminos < settings->headless && !game->over) {
+		Tetri target;
+		if(choose_placement(game->grid, scratch, &(game->tetri), &target)) {
+			steer_tetri(game->grid, &(game->tetri), &target);
+		}
+
+		int rows = game->completed_rows, games = game->games;
+
+		inputs[DROP_EVENT] = true;
+		game_step(game, inputs, 0);
+		inputs[DROP_EVENT] = false;
+
+		if(game->games == games) {
+			completed_rows += game->completed_rows - rows;
+		}
+	}
+
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	printf("seed: %d\n", settings->seed);
+	printf("games: %d\n", game->games);
+	printf("tetriminos: %d\n", game->tetriminos);
+	printf("completed rows: %d\n", completed_rows);
+	printf("cpu time: %.3f s\n", seconds);
+	if(seconds > 0) {
+		printf("tetriminos per second: %.0f\n", game->tetriminos / seconds);
+	}
+
+	destroy_grid(scratch);
+	destroy_game(game);
+
+	return EXIT_SUCCESS;
+}
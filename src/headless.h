@@ -0,0 +1,14 @@
+
+#ifndef H_HEADLESS
+#define H_HEADLESS
+
+#include "param.h"
+
+/*
+ * play settings->headless tetriminos with the bot, as fast as possible and without any window
+ * then print the number of tetriminos played per second and the number of completed rows
+ * return EXIT_SUCCESS, or EXIT_FAILURE if memory allocation failed
+ */
+int run_headless(const Settings *settings);
+
+#endif
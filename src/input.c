@@ -0,0 +1,229 @@
+
+/*
+ * input.c
+ *
+ * Copyright 2012 Bresson Matthieu <mbresson@etudiant.univ-mlv.fr>
+ *
+ * This file is part of Blockmatic.
+ *
+ * Blockmatic is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Blockmatic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULIAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Blockmatic. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "input.h"
+
+#include "debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * the names of the events, in the order of Event
+ */
+static const char *s_names[__LAST_EVENT] = {
+	"delete",
+	"drop",
+	"exit",
+	"focus-gained",
+	"focus-lost",
+	"left",
+	"newgame",
+	"pause",
+	"right",
+	"rotate-clockwise",
+	"rotate-counterclockwise",
+	"shift"
+};
+
+
+void clear_inputs(InputQueue *queue) {
+	assert(queue != NULL);
+
+	queue->head = 0;
+	queue->tail = 0;
+}
+
+
+Event find_event(const char *name) {
+	assert(name != NULL);
+
+	for(int event = 0; event < __LAST_EVENT; event++) {
+		if(strcmp(s_names[event], name) == 0) {
+			return (Event) event;
+		}
+	}
+
+	return __LAST_EVENT;
+}
+
+
+void init_autoshift(AutoShift *shift, int das, int arr, int moves) {
+	assert(shift != NULL);
+	assert(das >= 0); assert(arr >= 0); assert(moves > 0);
+
+	shift->das = das;
+	shift->arr = arr;
+	shift->moves = moves;
+
+	shift->event = __LAST_EVENT;
+	shift->other = __LAST_EVENT;
+	shift->held[0] = shift->held[1] = 0;
+	shift->next = 0;
+	shift->wall = false;
+}
+
+
+bool peek_input(const InputQueue *queue, Input *input) {
+	assert(queue != NULL);
+	assert(input != NULL);
+
+	if(queue->head == queue->tail) {
+		return false;
+	}
+
+	*input = queue->inputs[queue->head % INPUT_QUEUE_SIZE];
+
+	return true;
+}
+
+
+bool pop_input(InputQueue *queue, Input *input) {
+	assert(queue != NULL);
+
+	if(!peek_input(queue, input)) {
+		return false;
+	}
+
+	queue->head++;
+
+	return true;
+}
+
+
+void press_autoshift(AutoShift *shift, Event event, uint32_t time) {
+	assert(shift != NULL);
+	assert(event == LEFT_EVENT || event == RIGHT_EVENT);
+
+	shift->held[event == RIGHT_EVENT]++;
+
+	if(shift->event != event) {
+		shift->other = shift->event;
+		shift->event = event;
+	}
+
+	shift->next = time + (uint32_t) shift->das;
+	shift->wall = false;
+}
+
+
+bool push_input(InputQueue *queue, Event event, uint32_t time) {
+	assert(queue != NULL);
+	assert(event >= 0); assert(event < __LAST_EVENT);
+
+	if(queue->tail - queue->head == INPUT_QUEUE_SIZE) {
+		return false;
+	}
+
+	queue->inputs[queue->tail % INPUT_QUEUE_SIZE].event = event;
+	queue->inputs[queue->tail % INPUT_QUEUE_SIZE].time = time;
+	queue->tail++;
+
+	return true;
+}
+
+
+/*
+ * push into queue the moves of shift against the wall at time
+ * if queue is full, return false
+ */
+static bool push_wall_moves(const AutoShift *shift, InputQueue *queue, uint32_t time) {
+	for(int move = 0; move < shift->moves; move++) {
+		if(!push_input(queue, shift->event, time)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool rearm_autoshift(AutoShift *shift, InputQueue *queue, uint32_t time) {
+	assert(shift != NULL);
+	assert(queue != NULL);
+
+	if(shift->arr != 0 || !shift->wall || shift->event == __LAST_EVENT) {
+		return true;
+	}
+
+	return push_wall_moves(shift, queue, time);
+}
+
+
+void release_autoshift(AutoShift *shift, Event event, uint32_t time) {
+	assert(shift != NULL);
+	assert(event == LEFT_EVENT || event == RIGHT_EVENT);
+
+	// another key of event is still held
+	int *held = &(shift->held[event == RIGHT_EVENT]);
+	if(*held > 1) {
+		(*held)--;
+		return;
+	}
+	*held = 0;
+
+	if(shift->other == event) {
+		shift->other = __LAST_EVENT;
+	} else if(shift->event == event) {
+		// the other key, still held, charges again
+		shift->event = shift->other;
+		shift->other = __LAST_EVENT;
+		shift->next = time + (uint32_t) shift->das;
+		shift->wall = false;
+	}
+}
+
+
+bool repeat_autoshift(AutoShift *shift, InputQueue *queue, uint32_t time) {
+	assert(shift != NULL);
+	assert(queue != NULL);
+
+	if(shift->event == __LAST_EVENT || shift->wall || (int32_t) (time - shift->next) < 0) {
+		return true;
+	}
+
+	// instantly against the wall, it cannot go further until the next tetri
+	if(shift->arr == 0) {
+		shift->wall = true;
+
+		return push_wall_moves(shift, queue, shift->next);
+	}
+
+	uint32_t arr = (uint32_t) shift->arr;
+
+	uint32_t due = (time - shift->next) / arr + 1;
+	if(due > (uint32_t) shift->moves) {
+		shift->next += (due - (uint32_t) shift->moves) * arr;
+		due = (uint32_t) shift->moves;
+	}
+
+	for(; due > 0; due--) {
+		if(!push_input(queue, shift->event, shift->next)) {
+			return false;
+		}
+
+		shift->next += arr;
+	}
+
+	return true;
+}
@@ -0,0 +1,109 @@
+
+#ifndef H_INPUT
+#define H_INPUT
+
+#include "game.h"
+
+#include <stdint.h>
+
+/*
+ * the number of inputs which can wait in a queue, a power of 2
+ */
+#define INPUT_QUEUE_SIZE 256
+
+/*
+ * an action of the user (or of a bot) and the time it happened, in ms
+ */
+typedef struct {
+	Event event;
+	uint32_t time;
+} Input;
+
+/*
+ * a ring buffer of inputs, popped in the order they were pushed
+ * head and tail only grow, they are wrapped when indexing inputs
+ */
+typedef struct {
+	Input inputs[INPUT_QUEUE_SIZE];
+	unsigned int head, tail;
+} InputQueue;
+
+/*
+ * the auto-shift of the tetri while left or right is held
+ * das ms after the key is pressed, a move is repeated every arr ms
+ * if arr is 0, moves moves at once shift the tetri against the wall, then again for each new tetri
+ * if both directions are held, the last one pressed wins, until all of its keys are released
+ */
+typedef struct {
+	int das, arr;
+	int moves; // the number of moves across the whole grid
+
+	Event event, other; // the held directions, LEFT_EVENT or RIGHT_EVENT, __LAST_EVENT if none
+	int held[2]; // the number of keys held for left and for right
+	uint32_t next; // when the next move is due
+	bool wall; // if arr is 0, whether the moves against the wall were pushed since das passed
+} AutoShift;
+
+
+/*
+ * empty queue
+ */
+void clear_inputs(InputQueue *queue);
+
+/*
+ * return the event named name (such as "left" or "rotate-clockwise"), or __LAST_EVENT if there is none
+ * the names are the ones of the keymap files and of the capture scripts
+ */
+Event find_event(const char *name);
+
+/*
+ * set up shift with delays das and arr in ms, moves being the number of columns of the grid
+ * no key is held
+ */
+void init_autoshift(AutoShift *shift, int das, int arr, int moves);
+
+/*
+ * store the oldest input of queue in input without popping it
+ * if queue is empty, return false
+ */
+bool peek_input(const InputQueue *queue, Input *input);
+
+/*
+ * store the oldest input of queue in input, then remove it from queue
+ * if queue is empty, return false
+ */
+bool pop_input(InputQueue *queue, Input *input);
+
+/*
+ * start charging the auto-shift of event (LEFT_EVENT or RIGHT_EVENT), one of whose keys was pressed at time
+ * the move of the press itself is up to the caller
+ */
+void press_autoshift(AutoShift *shift, Event event, uint32_t time);
+
+/*
+ * add event, which happened at time, at the end of queue
+ * if queue is full, return false
+ */
+bool push_input(InputQueue *queue, Event event, uint32_t time);
+
+/*
+ * if arr is 0 and shift is against the wall, push into queue the moves which shift a new tetri there at time
+ * if queue is full, return false
+ */
+bool rearm_autoshift(AutoShift *shift, InputQueue *queue, uint32_t time);
+
+/*
+ * release a key of event (LEFT_EVENT or RIGHT_EVENT) at time
+ * its auto-shift stops once the last of its keys is released
+ */
+void release_autoshift(AutoShift *shift, Event event, uint32_t time);
+
+/*
+ * push into queue every move due by shift until time, each one at the time it is due
+ * past moves moves in a single call, the older ones are skipped since the tetri is against the wall
+ * if arr is 0, the moves against the wall are pushed once, see rearm_autoshift for the next tetri
+ * if queue is full, return false
+ */
+bool repeat_autoshift(AutoShift *shift, InputQueue *queue, uint32_t time);
+
+#endif
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /*
  * this two pointers are there because
@@ -74,6 +75,14 @@ static inline void set_default_settings(Settings *obj) {
 	 * to its default value if no other value was provided
 	 */
 
+	if(obj->arr == -1) {
+		obj->arr = DEFAULT_ARR;
+	}
+
+	if(obj->backend == UNDEF_BACKEND) {
+		obj->backend = DEFAULT_BACKEND;
+	}
+
 	if(obj->background_file == NULL) {
 		obj->background_file = DEFAULT_BACKGROUND_FILE;
 	}
@@ -117,10 +126,18 @@ static inline void set_default_settings(Settings *obj) {
 		obj->blocks_per_row = DEFAULT_BLOCKS_PER_ROW;
 	}
 
+	if(obj->capture == NULL) {
+		obj->capture = DEFAULT_CAPTURE;
+	}
+
 	if(obj->cheatmode == undef) {
 		obj->cheatmode = false;
 	}
 
+	if(obj->das == -1) {
+		obj->das = DEFAULT_DAS;
+	}
+
 	if(obj->decrease == -1) {
 		obj->decrease = DEFAULT_DECREASE;
 	}
@@ -129,6 +146,10 @@ static inline void set_default_settings(Settings *obj) {
 		obj->delay = DEFAULT_DELAY;
 	}
 
+	if(obj->dirty_rects == undef) {
+		obj->dirty_rects = DEFAULT_DIRTY_RECTS;
+	}
+
 	if(obj->duration == -1) {
 		obj->duration = DEFAULT_DURATION;
 	}
@@ -161,14 +182,42 @@ static inline void set_default_settings(Settings *obj) {
 		obj->font_color.blue = DEFAULT_FONT_BLUE;
 	}
 
+	if(obj->framerate == -1) {
+		obj->framerate = DEFAULT_FRAMERATE;
+	}
+
+	if(obj->frame_stats == undef) {
+		obj->frame_stats = DEFAULT_FRAME_STATS;
+	}
+
+	if(obj->headless == -1) {
+		obj->headless = DEFAULT_HEADLESS;
+	}
+
 	if(obj->hints == undef) {
 		obj->hints = DEFAULT_HINTS;
 	}
 
+	if(obj->inject == -1) {
+		obj->inject = DEFAULT_INJECT;
+	}
+
+	if(obj->keymap == NULL) {
+		obj->keymap = DEFAULT_KEYMAP;
+	}
+
 	if(obj->keyrepeat == undef) {
 		obj->keyrepeat = DEFAULT_KEYREPEAT;
 	}
 
+	if(obj->late_latch == undef) {
+		obj->late_latch = DEFAULT_LATE_LATCH;
+	}
+
+	if(obj->latency_report == undef) {
+		obj->latency_report = DEFAULT_LATENCY_REPORT;
+	}
+
 	if(obj->preview == undef) {
 		obj->preview = DEFAULT_PREVIEW;
 	}
@@ -189,6 +238,10 @@ static inline void set_default_settings(Settings *obj) {
 		obj->pause_color.blue = DEFAULT_PAUSE_BLUE;
 	}
 
+	if(obj->randomizer == UNDEF_RANDOMIZER) {
+		obj->randomizer = DEFAULT_RANDOMIZER;
+	}
+
 	if(obj->restart == undef) {
 		obj->restart = DEFAULT_RESTART;
 	}
@@ -197,6 +250,11 @@ static inline void set_default_settings(Settings *obj) {
 		obj->rows = DEFAULT_ROWS;
 	}
 
+	// without a user-defined seed, every game is different
+	if(obj->seed == -1) {
+		obj->seed = (int) (time(NULL) % INT_MAX);
+	}
+
 	if(obj->threshold == -1) {
 		obj->threshold = DEFAULT_THRESHOLD;
 	}
@@ -205,10 +263,18 @@ static inline void set_default_settings(Settings *obj) {
 		obj->usedelay = DEFAULT_USEDELAY;
 	}
 
+	if(obj->tickrate == -1) {
+		obj->tickrate = DEFAULT_TICKRATE;
+	}
+
 	if(obj->vi_mode == undef) {
 		obj->vi_mode = DEFAULT_VI_MODE;
 	}
 
+	if(obj->vsync == undef) {
+		obj->vsync = DEFAULT_VSYNC;
+	}
+
 	if(obj->window_icon == NULL) {
 		obj->window_icon = DEFAULT_WINDOW_ICON;
 	}
@@ -234,6 +300,10 @@ static inline void set_undef_settings(Settings *obj) {
 	 * bool => undef
 	 */
 
+	obj->arr = -1;
+
+	obj->backend = UNDEF_BACKEND;
+
 	obj->background_file = NULL;
 	obj->background_center = undef;
 	obj->background_crop = undef;
@@ -247,10 +317,14 @@ static inline void set_undef_settings(Settings *obj) {
 	obj->blocks_per_col = -1;
 	obj->blocks_per_row = -1;
 
+	obj->capture = NULL;
+
 	obj->cheatmode = undef;
 
+	obj->das = -1;
 	obj->decrease = -1;
 	obj->delay = -1;
+	obj->dirty_rects = undef;
 	obj->duration = -1;
 
 	obj->foresee_fallen = undef;
@@ -263,9 +337,21 @@ static inline void set_undef_settings(Settings *obj) {
 	obj->font_color.green = -1;
 	obj->font_color.blue = -1;
 
+	obj->framerate = -1;
+	obj->frame_stats = undef;
+
+	obj->headless = -1;
+
 	obj->hints = undef;
 
+	obj->inject = -1;
+
+	obj->keymap = NULL;
 	obj->keyrepeat = undef;
+
+	obj->late_latch = undef;
+	obj->latency_report = undef;
+
 	obj->preview = undef;
 
 	obj->pause_message = NULL;
@@ -274,15 +360,23 @@ static inline void set_undef_settings(Settings *obj) {
 	obj->pause_color.green = -1;
 	obj->pause_color.blue = -1;
 
+	obj->randomizer = UNDEF_RANDOMIZER;
+
 	obj->restart = undef;
 
 	obj->rows = -1;
 
+	obj->seed = -1;
+
 	obj->threshold = -1;
 	obj->usedelay = undef;
 
+	obj->tickrate = -1;
+
 	obj->vi_mode = undef;
 
+	obj->vsync = undef;
+
 	obj->window_icon = NULL;
 	obj->window_title = NULL;
 	obj->window_noborder = undef;
@@ -336,6 +430,66 @@ static void check_to_warn(Settings *obj) {
 		obj->delay = -1;
 	}
 
+	// if dirty rectangles are set but every frame is captured offscreen
+	if(obj->dirty_rects == true && obj->capture != NULL) {
+		fprintf(stderr, "'%s': statement with no effect (frames are drawn offscreen ('%s'))!\n",
+			PARAM_DIRTY_RECTS, PARAM_CAPTURE);
+
+		obj->dirty_rects = undef;
+	}
+
+	// if vsync is set but the frames are never presented to the display by a hardware renderer
+	if(obj->vsync == true && (obj->dirty_rects == true || obj->capture != NULL)) {
+		fprintf(stderr, "'%s': statement with no effect (frames aren't presented with vsync ('%s' or '%s'))!\n",
+			PARAM_VSYNC, PARAM_DIRTY_RECTS, PARAM_CAPTURE);
+
+		obj->vsync = undef;
+	}
+
+	// if a framerate is set but the display paces the frames
+	if(obj->framerate != -1 && obj->vsync == true) {
+		fprintf(stderr, "'%s': statement with no effect (the display paces the frames ('%s'))!\n",
+			PARAM_FRAMERATE, PARAM_VSYNC);
+
+		obj->framerate = -1;
+	}
+
+	// if frame statistics are asked for but no frame is shown
+	if(obj->frame_stats == true && (obj->headless != -1 || obj->capture != NULL)) {
+		fprintf(stderr, "'%s': statement with no effect (no frame is shown ('%s' or '%s'))!\n",
+			PARAM_FRAME_STATS, PARAM_HEADLESS, PARAM_CAPTURE);
+
+		obj->frame_stats = undef;
+	}
+
+	// if auto-shift is tuned but key repeat is disabled
+	if((obj->das != -1 || obj->arr != -1) && (obj->keyrepeat == false ||
+		(obj->keyrepeat == undef && !DEFAULT_KEYREPEAT))) {
+
+		fprintf(stderr, "'%s', '%s': statement with no effect (key repeat is disabled ('%s'))!\n",
+			PARAM_DAS, PARAM_ARR, PARAM_NOKEYREPEAT);
+
+		obj->das = -1;
+		obj->arr = -1;
+	}
+
+	// if inputs are handled late but there is no window to receive them
+	if(obj->late_latch == true && (obj->headless != -1 || obj->capture != NULL)) {
+		fprintf(stderr, "'%s': statement with no effect (no window receives inputs ('%s' or '%s'))!\n",
+			PARAM_LATE_LATCH, PARAM_HEADLESS, PARAM_CAPTURE);
+
+		obj->late_latch = undef;
+	}
+
+	// if inputs are injected or measured but there is no window to receive them
+	if((obj->inject != -1 || obj->latency_report == true) && (obj->headless != -1 || obj->capture != NULL)) {
+		fprintf(stderr, "'%s', '%s': statement with no effect (no window receives inputs ('%s' or '%s'))!\n",
+			PARAM_INJECT, PARAM_LATENCY_REPORT, PARAM_HEADLESS, PARAM_CAPTURE);
+
+		obj->inject = -1;
+		obj->latency_report = undef;
+	}
+
 	// if a threshold is set but won't be used
 	if(obj->threshold != -1 && (obj->usedelay == true ||
 		(obj->usedelay == undef && DEFAULT_USEDELAY))) {
@@ -500,6 +654,32 @@ Settings* parse_params(int argc, char **argv) {
 
 			tmp->leave = true;
 
+		} else if(equals(param, PARAM_ARR)) {
+			if(!check_numeric_parameter(index, &(tmp->arr), 0, 1000)) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
+		} else if(equals(param, PARAM_BACKEND)) {
+			if(index == (*s_argc) - 1) {
+				fprintf(stderr, "'%s': you must provide a string!\n", param);
+				tmp->leave = true;
+			} else if(tmp->backend != UNDEF_BACKEND) {
+				fprintf(stderr, "'%s': you cannot define it twice!\n", param);
+				tmp->leave = true;
+			} else if(equals(s_argv[index+1], BACKEND_SDL)) {
+				tmp->backend = SDL_BACKEND;
+				index++;
+			} else if(equals(s_argv[index+1], BACKEND_RASTER)) {
+				tmp->backend = RASTER_BACKEND;
+				index++;
+			} else {
+				fprintf(stderr, "'%s': value '%s' must be '%s' or '%s'!\n",
+					param, s_argv[index+1], BACKEND_SDL, BACKEND_RASTER);
+				tmp->leave = true;
+			}
+
 		} else if(equals(param, PARAM_BACKGROUND_FILE)) {
 			if(!check_file_parameter(index, &(tmp->background_file))) {
 				tmp->leave = true;
@@ -544,7 +724,21 @@ Settings* parse_params(int argc, char **argv) {
 			}
 
 		} else if(equals(param, PARAM_BLOCKS_PER_ROW)) {
-			if(!check_numeric_parameter(index, &(tmp->blocks_per_row), 8, INT_MAX)) {
+			if(!check_numeric_parameter(index, &(tmp->blocks_per_row), 8, MAX_BLOCKS_PER_ROW)) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
+		} else if(equals(param, PARAM_CAPTURE)) {
+			if(!check_file_parameter(index, &(tmp->capture))) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
+		} else if(equals(param, PARAM_DAS)) {
+			if(!check_numeric_parameter(index, &(tmp->das), 0, 1000)) {
 				tmp->leave = true;
 			} else {
 				index++;
@@ -564,6 +758,9 @@ Settings* parse_params(int argc, char **argv) {
 				index++;
 			}
 
+		} else if(equals(param, PARAM_DIRTY_RECTS)) {
+			tmp->dirty_rects = true;
+
 		} else if(equals(param, PARAM_DURATION)) {
 			if(!check_numeric_parameter(index, &(tmp->duration), 100, 10000)) {
 				tmp->leave = true;
@@ -603,6 +800,43 @@ Settings* parse_params(int argc, char **argv) {
 				index++;
 			}
 
+		} else if(equals(param, PARAM_FRAMERATE)) {
+			if(!check_numeric_parameter(index, &(tmp->framerate), 0, 1000)) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
+		} else if(equals(param, PARAM_FRAME_STATS)) {
+			tmp->frame_stats = true;
+
+		} else if(equals(param, PARAM_HEADLESS)) {
+			if(!check_numeric_parameter(index, &(tmp->headless), 1, INT_MAX)) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
+		} else if(equals(param, PARAM_INJECT)) {
+			if(!check_numeric_parameter(index, &(tmp->inject), 1, INT_MAX)) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
+		} else if(equals(param, PARAM_KEYMAP)) {
+			if(!check_file_parameter(index, &(tmp->keymap))) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
+		} else if(equals(param, PARAM_LATE_LATCH)) {
+			tmp->late_latch = true;
+
+		} else if(equals(param, PARAM_LATENCY_REPORT)) {
+			tmp->latency_report = true;
+
 		} else if(equals(param, PARAM_NOHINTS)) {
 			tmp->hints = false;
 
@@ -641,6 +875,25 @@ Settings* parse_params(int argc, char **argv) {
 				index++;
 			}
 
+		} else if(equals(param, PARAM_RANDOMIZER)) {
+			if(index == (*s_argc) - 1) {
+				fprintf(stderr, "'%s': you must provide a string!\n", param);
+				tmp->leave = true;
+			} else if(tmp->randomizer != UNDEF_RANDOMIZER) {
+				fprintf(stderr, "'%s': you cannot define it twice!\n", param);
+				tmp->leave = true;
+			} else if(equals(s_argv[index+1], RANDOMIZER_UNIFORM)) {
+				tmp->randomizer = UNIFORM_RANDOMIZER;
+				index++;
+			} else if(equals(s_argv[index+1], RANDOMIZER_BAG)) {
+				tmp->randomizer = BAG_RANDOMIZER;
+				index++;
+			} else {
+				fprintf(stderr, "'%s': value '%s' must be '%s' or '%s'!\n",
+					param, s_argv[index+1], RANDOMIZER_UNIFORM, RANDOMIZER_BAG);
+				tmp->leave = true;
+			}
+
 		} else if(equals(param, PARAM_RESTART)) {
 			tmp->restart = true;
 
@@ -652,6 +905,13 @@ Settings* parse_params(int argc, char **argv) {
 				index++;
 			}
 
+		} else if(equals(param, PARAM_SEED)) {
+			if(!check_numeric_parameter(index, &(tmp->seed), 0, INT_MAX)) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
 		} else if(equals(param, PARAM_THRESHOLD)) {
 			if(!check_numeric_parameter(index, &(tmp->threshold), 1, 1000000)) {
 				tmp->leave = true;
@@ -659,12 +919,22 @@ Settings* parse_params(int argc, char **argv) {
 				index++;
 			}
 
+		} else if(equals(param, PARAM_TICKRATE)) {
+			if(!check_numeric_parameter(index, &(tmp->tickrate), 10, 1000)) {
+				tmp->leave = true;
+			} else {
+				index++;
+			}
+
 		} else if(equals(param, PARAM_USEDELAY)) {
 			tmp->usedelay = true;
 
 		} else if(equals(param, PARAM_VI_MODE)) {
 			tmp->vi_mode = true;
 
+		} else if(equals(param, PARAM_VSYNC)) {
+			tmp->vsync = true;
+
 		} else if(equals(param, PARAM_WINDOW_ICON)) {
 			if(!check_file_parameter(index, &(tmp->window_icon))) {
 				tmp->leave = true;
@@ -711,6 +981,16 @@ static void print_help(void) {
 	printf("\t" PARAM_VERSION "\n \
 		display version information\n\n");
 
+	printf("\t" PARAM_ARR " number\n \
+		the number of milliseconds between two moves when left or right is held, after " PARAM_DAS "\n \
+		0 moves the tetrimino against the wall at once\n \
+		default: %d, min: 0, max: 1000\n\n", DEFAULT_ARR);
+
+	printf("\t" PARAM_BACKEND " " BACKEND_SDL "|" BACKEND_RASTER "\n \
+		the way the frames are drawn: by the SDL renderer,\n \
+		or in memory by the built-in rasterizer, then sent as a single texture\n \
+		default: %s\n\n", DEFAULT_BACKEND == RASTER_BACKEND ? BACKEND_RASTER : BACKEND_SDL);
+
 	printf("\t" PARAM_BACKGROUND_FILE " file.{png,jpg,bmp}\n \
 		the path to a background image\n \
 		default: %s\n\n", DEFAULT_BACKGROUND_FILE == NULL ? "no background image" : DEFAULT_BACKGROUND_FILE);
@@ -741,7 +1021,24 @@ static void print_help(void) {
 
 	printf("\t" PARAM_BLOCKS_PER_ROW " number\n \
 		the number of blocks per row (used when computing the window's width)\n \
-		default: %d, min: 8\n\n", DEFAULT_BLOCKS_PER_ROW);
+		default: %d, min: 8, max: %d\n\n", DEFAULT_BLOCKS_PER_ROW, MAX_BLOCKS_PER_ROW);
+
+	printf("\t" PARAM_CAPTURE " file\n \
+		play the inputs of a script without showing any window, save the frames it asks for,\n \
+		then print the time taken by each drawing function\n \
+		each line of the script is either:\n \
+		  one or more inputs among delete, drop, focus-gained, focus-lost, left, newgame,\n \
+		  pause, right, rotate-clockwise, rotate-counterclockwise and shift,\n \
+		  wait ms,\n \
+		  capture file.png, or capture file to save raw 0xAARRGGBB pixels\n \
+		use " PARAM_SEED " to capture the same frames every time\n \
+		without a display, run it with SDL_VIDEODRIVER=dummy\n \
+		default: no capture\n\n");
+
+	printf("\t" PARAM_DAS " number\n \
+		the number of milliseconds left or right must be held before the tetrimino keeps moving\n \
+		it doesn't depend on the key repeat of the system, " PARAM_NOKEYREPEAT " disables it\n \
+		default: %d, min: 0, max: 1000\n\n", DEFAULT_DAS);
 
 	printf("\t" PARAM_DECREASE " number\n \
 		the percentage of duration (ms) decrease\n \
@@ -751,6 +1048,10 @@ static void print_help(void) {
 		the number of seconds before duration (ms) is decreased by decrease (%%)\n \
 		default: %d%%, min: 1, max: 86400\n\n", DEFAULT_DELAY);
 
+	printf("\t" PARAM_DIRTY_RECTS "\n \
+		if set, use the software renderer and redraw only the parts of the window which changed\n \
+		default: %s\n\n", DEFAULT_DIRTY_RECTS ? "dirty rectangles only" : "whole window redrawn");
+
 	printf("\t" PARAM_DURATION " number\n \
 		the number of milliseconds to wait before moving down a tetri\n \
 		default: %d, min: 100, max: 10000\n\n", DEFAULT_DURATION);
@@ -775,6 +1076,44 @@ static void print_help(void) {
 		set a color for the text in the format 'red,green,blue'\n \
 		default: %d,%d,%d, min: 0, max: 255\n\n", DEFAULT_FONT_RED, DEFAULT_FONT_GREEN, DEFAULT_FONT_BLUE);
 
+	printf("\t" PARAM_FRAMERATE " number\n \
+		the number of frames per second, such as 60, 120, 144 or 240\n \
+		0 draws the frames as fast as possible\n \
+		default: %d, min: 0, max: 1000\n\n", DEFAULT_FRAMERATE);
+
+	printf("\t" PARAM_FRAME_STATS "\n \
+		if set, print the percentiles of the frame times when leaving\n \
+		default: %s\n\n", DEFAULT_FRAME_STATS ? "frame times printed" : "nothing printed");
+
+	printf("\t" PARAM_HEADLESS " number\n \
+		play this number of tetriminos with a bot, without any window,\n \
+		then print the number of tetriminos played per second and leave\n \
+		default: no headless mode, min: 1\n\n");
+
+	printf("\t" PARAM_INJECT " number\n \
+		press left and right alternately this number of times, one every %d ms,\n \
+		with events sent to the game itself, then leave\n \
+		used with " PARAM_LATENCY_REPORT " (and SDL_VIDEODRIVER=dummy without a display)\n \
+		default: no injection, min: 1\n\n", INJECT_PERIOD);
+
+	printf("\t" PARAM_KEYMAP " file\n \
+		the path to a file binding keys to actions, over the control keys below\n \
+		each line is an action among delete, drop, exit, left, newgame, pause, right,\n \
+		rotate-clockwise, rotate-counterclockwise and shift, then the name of a key (such as Left or Space),\n \
+		prefixed with shift+ if shift must be held; an action can be bound to several keys, one per line\n \
+		default: no keymap file\n\n");
+
+	printf("\t" PARAM_LATE_LATCH "\n \
+		if set, each frame is drawn before waiting for the time to send it,\n \
+		then the inputs received in between move the tetrimino just before it is sent\n \
+		this has little effect with " PARAM_VSYNC ", where sending the frame is what waits\n \
+		default: %s\n\n", DEFAULT_LATE_LATCH ? "late inputs" : "inputs before drawing");
+
+	printf("\t" PARAM_LATENCY_REPORT "\n \
+		if set, display the latency between the last input and the frame showing it\n \
+		and the 99th percentile (in ms, at the bottom right), then print its percentiles when leaving\n \
+		default: %s\n\n", DEFAULT_LATENCY_REPORT ? "latency reported" : "no report");
+
 	printf("\t" PARAM_NOHINTS "\n \
 		if set, no hints will be displayed (hints == time remaining until moving down)\n \
 		default: %s\n\n", DEFAULT_HINTS ? "hints allowed" : "no hints");
@@ -795,6 +1134,11 @@ static void print_help(void) {
 		set a color for the screen when the game is paused in the format 'red,green,blue'\n \
 		default: %d,%d,%d, min: 0, max: 255\n\n", DEFAULT_PAUSE_RED, DEFAULT_PAUSE_GREEN, DEFAULT_PAUSE_BLUE);
 
+	printf("\t" PARAM_RANDOMIZER " " RANDOMIZER_UNIFORM "|" RANDOMIZER_BAG "\n \
+		the way the next tetrimino is chosen: purely at random,\n \
+		or from a shuffled bag of the 7 tetriminos which is refilled when empty\n \
+		default: %s\n\n", DEFAULT_RANDOMIZER == BAG_RANDOMIZER ? RANDOMIZER_BAG : RANDOMIZER_UNIFORM);
+
 	printf("\t" PARAM_RESTART "\n \
 		if set, when the game is over, a new game is started\n \
 		default: %s\n\n", DEFAULT_RESTART ? "restart enabled" : "no restart");
@@ -804,10 +1148,19 @@ static void print_help(void) {
 		default: %d, min: 0, max: %d or the user-defined number of blocks per column\n\n",
 		DEFAULT_ROWS, DEFAULT_BLOCKS_PER_COL);
 
+	printf("\t" PARAM_SEED " number\n \
+		the number used to initialize the random generators, to replay the same game\n \
+		default: based on the current time, min: 0\n\n");
+
 	printf("\t" PARAM_THRESHOLD " number\n \
 		the number of rows to be completed before duration (ms) is decreased by decrease (%%)\n \
 		default: %d%%, min: 1, max: 1000000\n\n", DEFAULT_THRESHOLD);
 
+	printf("\t" PARAM_TICKRATE " number\n \
+		the number of game steps per second, whatever the framerate\n \
+		the falling tetrimino slides toward the next row as gravity progresses\n \
+		default: %d, min: 10, max: 1000\n\n", DEFAULT_TICKRATE);
+
 	printf("\t" PARAM_USEDELAY "\n \
 		to decide if duration (ms) must be decreased after delay (s)\n \
 		default: %s\n\n", DEFAULT_USEDELAY ? "use delay" : "use threshold");
@@ -816,6 +1169,10 @@ static void print_help(void) {
 		if set, alternative control keys will be used\n \
 		default: %s\n\n", DEFAULT_VI_MODE ? "vi-like control keys" : "normal control keys");
 
+	printf("\t" PARAM_VSYNC "\n \
+		if set, the frames are paced by the display's refresh rate instead of " PARAM_FRAMERATE "\n \
+		default: %s\n\n", DEFAULT_VSYNC ? "vsync" : "framerate");
+
 	printf("\t" PARAM_WINDOW_ICON " file.{png,jpg,bmp}\n \
 		the path to the window's icon file\n \
 		default: '" DEFAULT_WINDOW_ICON "'\n\n");
@@ -8,6 +8,26 @@
  * this set of constants defines a string for every legal parameter
  */
 
+/*
+ * the number of milliseconds between two moves when a left or right key is held, once auto-shift started
+ * 0 moves the tetri against the wall at once
+ * default: DEFAULT_ARR, min: 0, max: 1000
+ * Settings member: arr
+ */
+#define PARAM_ARR "--arr"
+
+/*
+ * the way the frames are drawn: by the SDL renderer or by the built-in rasterizer,
+ * which draws them in memory before sending them as a single texture
+ * format: sdl or raster
+ * default: DEFAULT_BACKEND
+ * Settings member: backend
+ */
+#define PARAM_BACKEND "--backend"
+
+#define BACKEND_SDL "sdl"
+#define BACKEND_RASTER "raster"
+
 /*
  * the path to the background image
  * default: DEFAULT_BACKGROUND_FILE
@@ -62,11 +82,26 @@
 
 /*
  * the number of blocks per row (used when computing the window's width)
- * default: DEFAULT_BLOCKS_PER_ROW, min: 8
+ * default: DEFAULT_BLOCKS_PER_ROW, min: 8, max: MAX_BLOCKS_PER_ROW
  * Settings member: blocks_per_row
  */
 #define PARAM_BLOCKS_PER_ROW "--blocks-per-row"
 
+/*
+ * the path to a script of inputs to play without showing any window,
+ * saving the frames it asks for, then timing each drawing function
+ * default: DEFAULT_CAPTURE (no capture mode)
+ * Settings member: capture
+ */
+#define PARAM_CAPTURE "--capture"
+
+/*
+ * the number of milliseconds a left or right key must be held before the tetri auto-shifts
+ * default: DEFAULT_DAS, min: 0, max: 1000
+ * Settings member: das
+ */
+#define PARAM_DAS "--das"
+
 /*
  * the percentage of duration (ms) decrease
  * default: DEFAULT_DECREASE, min: 0, max: 99
@@ -81,6 +116,14 @@
  */
 #define PARAM_DELAY "--delay"
 
+/*
+ * to redraw and present only the parts of the window which have changed since the last frame
+ * this uses the software renderer, for computers without any GPU
+ * default: DEFAULT_DIRTY_RECTS
+ * Settings member: dirty_rects
+ */
+#define PARAM_DIRTY_RECTS "--dirty-rects"
+
 /*
  * the number of milliseconds to wait before moving down a tetri
  * this number will decrease of decrease (%) after delay (s) or after threshold (number of rows)
@@ -127,11 +170,68 @@
  */
 #define PARAM_FONT_COLOR "--font-color"
 
+/*
+ * the number of frames per second, 0 to draw them as fast as possible
+ * default: DEFAULT_FRAMERATE, min: 0, max: 1000
+ * Settings member: framerate
+ */
+#define PARAM_FRAMERATE "--framerate"
+
+/*
+ * to print the percentiles of the frame times when leaving
+ * default: DEFAULT_FRAME_STATS
+ * Settings member: frame_stats
+ */
+#define PARAM_FRAME_STATS "--frame-stats"
+
+/*
+ * the number of tetriminos to be played by a bot without any window,
+ * before printing statistics and leaving
+ * default: DEFAULT_HEADLESS (no headless mode), min: 1
+ * Settings member: headless
+ */
+#define PARAM_HEADLESS "--headless"
+
 /*
  * to display some help
  */
 #define PARAM_HELP "--help"
 
+/*
+ * the number of presses of the left and right keys to inject as SDL events, one every INJECT_PERIOD ms,
+ * before leaving, to measure the latency without anyone at the keyboard
+ * default: DEFAULT_INJECT (no injection), min: 1
+ * Settings member: inject
+ */
+#define PARAM_INJECT "--inject"
+
+#define INJECT_PERIOD 100
+
+/*
+ * the path to a file binding keys to actions, over the normal or vi-like control keys
+ * each line is an action (such as left or rotate-clockwise) followed by the name of a key,
+ * prefixed with shift+ if shift must be held
+ * default: DEFAULT_KEYMAP (no keymap file)
+ * Settings member: keymap
+ */
+#define PARAM_KEYMAP "--keymap"
+
+/*
+ * to handle the inputs received while waiting for the next frame just before sending it,
+ * drawing the falling tetri again
+ * default: DEFAULT_LATE_LATCH
+ * Settings member: late_latch
+ */
+#define PARAM_LATE_LATCH "--late-latch"
+
+/*
+ * to display the latency between the inputs and the frames showing them,
+ * then print its percentiles when leaving
+ * default: DEFAULT_LATENCY_REPORT
+ * Settings member: latency_report
+ */
+#define PARAM_LATENCY_REPORT "--latency-report"
+
 /*
  * to decide if hints must be displayed or not (hints == time remaining until moving down)
  * default: DEFAULT_HINTS
@@ -169,6 +269,17 @@
  */
 #define PARAM_PAUSE_COLOR "--pause-color"
 
+/*
+ * the way the next tetrimino is chosen
+ * format: uniform or bag
+ * default: DEFAULT_RANDOMIZER
+ * Settings member: randomizer
+ */
+#define PARAM_RANDOMIZER "--randomizer"
+
+#define RANDOMIZER_UNIFORM "uniform"
+#define RANDOMIZER_BAG "bag"
+
 /*
  * to decide if a new game must be started in case of a game over
  * default: DEFAULT_RESTART
@@ -183,6 +294,13 @@
  */
 #define PARAM_ROWS "--rows"
 
+/*
+ * the number used to initialize the random generators, to replay the same sequence of tetriminos
+ * default: based on the current time, min: 0
+ * Settings member: seed
+ */
+#define PARAM_SEED "--seed"
+
 /*
  * the number of rows to be completed before duration (ms) is decreased by decrease (%)
  * default: DEFAULT_THRESHOLD, min: 1, max: 1000000
@@ -190,6 +308,13 @@
  */
 #define PARAM_THRESHOLD "--threshold"
 
+/*
+ * the number of game steps per second, whatever the framerate
+ * default: DEFAULT_TICKRATE, min: 10, max: 1000
+ * Settings member: tickrate
+ */
+#define PARAM_TICKRATE "--tickrate"
+
 /*
  * to decide if duration (ms) must be decreased after delay (s)
  * default: DEFAULT_USEDELAY
@@ -209,6 +334,13 @@
  */
 #define PARAM_VI_MODE "--vi-like"
 
+/*
+ * to let the display pace the frames instead of the framerate
+ * default: DEFAULT_VSYNC
+ * Settings member: vsync
+ */
+#define PARAM_VSYNC "--vsync"
+
 /*
  * the path to the window's icon file
  * default: DEFAULT_WINDOW_ICON
@@ -230,6 +362,26 @@
  */
 #define PARAM_WINDOW_NOBORDER "--noborder"
 
+/*
+ * the ways to draw the frames
+ */
+typedef enum {
+	UNDEF_BACKEND = -1,
+	SDL_BACKEND = 0, // SDL_Render* functions, usually hardware-accelerated
+	RASTER_BACKEND, // raster.c, in memory
+	__LAST_BACKEND
+} BackendType;
+
+/*
+ * the ways to choose the next tetrimino
+ */
+typedef enum {
+	UNDEF_RANDOMIZER = -1,
+	UNIFORM_RANDOMIZER = 0, // every tetrimino has the same chance to be chosen
+	BAG_RANDOMIZER, // the 7 tetriminos are dealt in a random order, then dealt again
+	__LAST_RANDOMIZER
+} RandomizerType;
+
 /*
  * the Settings struct is used to store the user's game settings
  * they can me changed with command-line parameters
@@ -240,6 +392,10 @@
  */
 
 typedef struct {
+	int arr;
+
+	BackendType backend;
+
 	char *background_file;
 	bool background_center;
 	bool background_crop;
@@ -253,10 +409,14 @@ typedef struct {
 	int blocks_per_col;
 	int blocks_per_row;
 
+	char *capture;
+
 	bool cheatmode; // if set to true, the player will be able to delete incomplete lines
 
+	int das;
 	int decrease;
 	int delay;
+	bool dirty_rects;
 	int duration;
 
 	char *font_file;
@@ -266,9 +426,21 @@ typedef struct {
 		int red, green, blue;
 	} font_color;
 
+	int framerate;
+	bool frame_stats;
+
+	int headless;
+
 	bool hints;
 
+	int inject;
+
+	char *keymap;
 	bool keyrepeat;
+
+	bool late_latch;
+	bool latency_report;
+
 	bool preview;
 
 	char *pause_message;
@@ -277,18 +449,26 @@ typedef struct {
 		int red, green, blue;
 	} pause_color;
 
+	RandomizerType randomizer;
+
 	bool restart;
 
 	int rows;
 
+	int seed;
+
 	bool foresee_fallen;
 	int fallen_opacity;
 
 	int threshold;
 	bool usedelay;
 
+	int tickrate;
+
 	bool vi_mode;
 
+	bool vsync;
+
 	char *window_icon;
 	char *window_title;
 	bool window_noborder;
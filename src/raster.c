@@ -0,0 +1,318 @@
+
+/*
+ * raster.c
+ *
+ * Copyright 2012 Bresson Matthieu <mbresson@etudiant.univ-mlv.fr>
+ *
+ * This file is part of Blockmatic.
+ *
+ * Blockmatic is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Blockmatic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULIAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Blockmatic. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "raster.h"
+
+#include "constants.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/*
+ * x / 255, rounded, for 0 <= x <= 255 * 255
+ */
+static inline uint32_t div255(uint32_t x) {
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+
+/*
+ * store in area the part of dest_area which is inside clip and inside dest
+ * return false if it is empty
+ */
+static bool clip_area(const Image *dest, const Area *clip, const Area *dest_area, Area *area) {
+	int left = dest_area->x, top = dest_area->y;
+	int right = dest_area->x + dest_area->w, bottom = dest_area->y + dest_area->h;
+
+	int clip_left = 0, clip_top = 0, clip_right = dest->width, clip_bottom = dest->height;
+
+	if(clip != NULL) {
+		if(clip->x > clip_left) {
+			clip_left = clip->x;
+		}
+
+		if(clip->y > clip_top) {
+			clip_top = clip->y;
+		}
+
+		if(clip->x + clip->w < clip_right) {
+			clip_right = clip->x + clip->w;
+		}
+
+		if(clip->y + clip->h < clip_bottom) {
+			clip_bottom = clip->y + clip->h;
+		}
+	}
+
+	area->x = left > clip_left ? left : clip_left;
+	area->y = top > clip_top ? top : clip_top;
+	area->w = (right < clip_right ? right : clip_right) - area->x;
+	area->h = (bottom < clip_bottom ? bottom : clip_bottom) - area->y;
+
+	return area->w > 0 && area->h > 0;
+}
+
+
+static inline uint32_t blend_pixel(uint32_t src, uint32_t dst, uint32_t opacity) {
+	uint32_t alpha = div255((src >> 24) * opacity);
+	uint32_t inverse = 255 - alpha;
+
+	uint32_t red = div255((src >> 16 & 0xFF) * alpha + (dst >> 16 & 0xFF) * inverse);
+	uint32_t green = div255((src >> 8 & 0xFF) * alpha + (dst >> 8 & 0xFF) * inverse);
+	uint32_t blue = div255((src & 0xFF) * alpha + (dst & 0xFF) * inverse);
+	uint32_t result_alpha = div255(255 * alpha + (dst >> 24) * inverse);
+
+	return result_alpha << 24 | red << 16 | green << 8 | blue;
+}
+
+
+#ifdef __SSE2__
+/*
+ * x / 255, rounded, for each 16-bit lane of x
+ */
+static inline __m128i div255_epi16(__m128i x) {
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+
+/*
+ * blend two pixels, each of their components being in a 16-bit lane
+ */
+static inline __m128i blend_pixels(__m128i src, __m128i dst, __m128i opacity) {
+	// the alpha of each pixel, in the 4 lanes of this pixel
+	__m128i alpha = _mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3));
+	alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+	alpha = div255_epi16(_mm_mullo_epi16(alpha, opacity));
+
+	__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+
+	// with 255 as the source alpha, the result alpha is alpha + dst alpha * (1 - alpha)
+	src = _mm_or_si128(src, _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0));
+
+	return div255_epi16(_mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, inverse)));
+}
+#endif
+
+
+/*
+ * blend count pixels of src over count pixels of dst
+ * four pixels at a time with SSE2
+ */
+static void blend_row(uint32_t *dst, const uint32_t *src, int count, uint32_t opacity) {
+	int index = 0;
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opacity16 = _mm_set1_epi16((short) opacity);
+
+	for(; index + 4 <= count; index += 4) {
+		__m128i src8 = _mm_loadu_si128((const __m128i*) (src + index));
+		__m128i dst8 = _mm_loadu_si128((const __m128i*) (dst + index));
+
+		__m128i low = blend_pixels(_mm_unpacklo_epi8(src8, zero), _mm_unpacklo_epi8(dst8, zero), opacity16);
+		__m128i high = blend_pixels(_mm_unpackhi_epi8(src8, zero), _mm_unpackhi_epi8(dst8, zero), opacity16);
+
+		_mm_storeu_si128((__m128i*) (dst + index), _mm_packus_epi16(low, high));
+	}
+#endif
+
+	for(; index < count; index++) {
+		dst[index] = blend_pixel(src[index], dst[index], opacity);
+	}
+}
+
+
+void blend_image(Image *dest, const Area *clip, const Image *src, const Area *src_area,
+	const Area *dest_area, int opacity) {
+	assert(dest != NULL);
+	assert(src != NULL);
+	assert(src_area != NULL);
+	assert(dest_area != NULL);
+	assert(opacity >= 0); assert(opacity < 256);
+	assert(src_area->x >= 0 && src_area->x + src_area->w <= src->width);
+	assert(src_area->y >= 0 && src_area->y + src_area->h <= src->height);
+
+	Area area;
+	if(!clip_area(dest, clip, dest_area, &area)) {
+		return;
+	}
+
+	if(src_area->w == dest_area->w && src_area->h == dest_area->h) {
+		int src_x = src_area->x + area.x - dest_area->x;
+		int src_y = src_area->y + area.y - dest_area->y;
+
+		for(int row = 0; row < area.h; row++) {
+			blend_row(dest->pixels + (area.y + row) * dest->width + area.x,
+				src->pixels + (src_y + row) * src->width + src_x,
+				area.w, (uint32_t) opacity);
+		}
+	} else { // scaled, the nearest source pixel is used
+		for(int y = area.y; y < area.y + area.h; y++) {
+			int src_y = src_area->y + (y - dest_area->y) * src_area->h / dest_area->h;
+
+			uint32_t *dst_row = dest->pixels + y * dest->width;
+			const uint32_t *src_row = src->pixels + src_y * src->width;
+
+			for(int x = area.x; x < area.x + area.w; x++) {
+				int src_x = src_area->x + (x - dest_area->x) * src_area->w / dest_area->w;
+
+				dst_row[x] = blend_pixel(src_row[src_x], dst_row[x], (uint32_t) opacity);
+			}
+		}
+	}
+}
+
+
+void copy_image(Image *dest, const Area *clip, const Image *src, const Area *src_area, int x, int y) {
+	assert(dest != NULL);
+	assert(src != NULL);
+	assert(src_area != NULL);
+	assert(src_area->x >= 0 && src_area->x + src_area->w <= src->width);
+	assert(src_area->y >= 0 && src_area->y + src_area->h <= src->height);
+
+	Area dest_area = {x, y, src_area->w, src_area->h};
+
+	Area area;
+	if(!clip_area(dest, clip, &dest_area, &area)) {
+		return;
+	}
+
+	int src_x = src_area->x + area.x - x;
+	int src_y = src_area->y + area.y - y;
+
+	for(int row = 0; row < area.h; row++) {
+		memcpy(dest->pixels + (area.y + row) * dest->width + area.x,
+			src->pixels + (src_y + row) * src->width + src_x,
+			sizeof(uint32_t) * (size_t) area.w);
+	}
+}
+
+
+Image* create_image(int width, int height) {
+	assert(width > 0);
+	assert(height > 0);
+
+	size_t size_of_pixels = sizeof(uint32_t) * (size_t) width * (size_t) height;
+
+	Image *image = malloc(sizeof(Image));
+	if(!image) {
+		fprintf(stderr, "Couldn't allocate %zu bytes!\n", sizeof(Image));
+		return NULL;
+	}
+
+	image->pixels = calloc(1, size_of_pixels);
+	if(!image->pixels) {
+		fprintf(stderr, "Couldn't allocate %zu bytes!\n", size_of_pixels);
+		free(image);
+		return NULL;
+	}
+
+	image->width = width;
+	image->height = height;
+
+	return image;
+}
+
+
+void destroy_image(Image *image) {
+	assert(image != NULL);
+
+	free(image->pixels);
+	free(image);
+}
+
+
+void fill_image(Image *dest, const Area *clip, uint32_t color) {
+	assert(dest != NULL);
+
+	Area whole = {0, 0, dest->width, dest->height};
+
+	Area area;
+	if(!clip_area(dest, clip, &whole, &area)) {
+		return;
+	}
+
+	for(int y = area.y; y < area.y + area.h; y++) {
+		uint32_t *row = dest->pixels + y * dest->width;
+
+		for(int x = area.x; x < area.x + area.w; x++) {
+			row[x] = color;
+		}
+	}
+}
+
+
+void modulate_image(Image *dest, const Area *clip, uint32_t color) {
+	assert(dest != NULL);
+
+	Area whole = {0, 0, dest->width, dest->height};
+
+	Area area;
+	if(!clip_area(dest, clip, &whole, &area)) {
+		return;
+	}
+
+	uint32_t red = color >> 16 & 0xFF, green = color >> 8 & 0xFF, blue = color & 0xFF;
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+
+	// the alpha of the pixels is kept
+	const __m128i color16 = _mm_set_epi16(255, (short) red, (short) green, (short) blue,
+		255, (short) red, (short) green, (short) blue);
+#endif
+
+	for(int y = area.y; y < area.y + area.h; y++) {
+		uint32_t *row = dest->pixels + y * dest->width + area.x;
+		int index = 0;
+
+#ifdef __SSE2__
+		for(; index + 4 <= area.w; index += 4) {
+			__m128i pixels = _mm_loadu_si128((const __m128i*) (row + index));
+
+			__m128i low = div255_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), color16));
+			__m128i high = div255_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), color16));
+
+			_mm_storeu_si128((__m128i*) (row + index), _mm_packus_epi16(low, high));
+		}
+#endif
+
+		for(; index < area.w; index++) {
+			uint32_t pixel = row[index];
+
+			row[index] = (pixel & 0xFF000000)
+				| div255((pixel >> 16 & 0xFF) * red) << 16
+				| div255((pixel >> 8 & 0xFF) * green) << 8
+				| div255((pixel & 0xFF) * blue);
+		}
+	}
+}
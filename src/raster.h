@@ -0,0 +1,62 @@
+
+#ifndef H_RASTER
+#define H_RASTER
+
+#include <stdint.h>
+
+/*
+ * an image in memory, one 0xAARRGGBB value per pixel, row after row
+ * nothing here depends on SDL, so frames can be drawn and checked without any window
+ */
+typedef struct {
+	uint32_t *pixels;
+	int width, height;
+} Image;
+
+/*
+ * a rectangle of pixels
+ */
+typedef struct {
+	int x, y, w, h;
+} Area;
+
+
+/*
+ * draw the src_area part of src in the dest_area part of dest, scaled if they are not the same size
+ * each pixel is blended according to its alpha multiplied by opacity, like SDL_BLENDMODE_BLEND
+ * nothing is drawn outside clip, or outside dest if clip is NULL
+ */
+void blend_image(Image *dest, const Area *clip, const Image *src, const Area *src_area,
+	const Area *dest_area, int opacity);
+
+/*
+ * copy the src_area part of src at (x, y) in dest, alpha included
+ * nothing is drawn outside clip, or outside dest if clip is NULL
+ */
+void copy_image(Image *dest, const Area *clip, const Image *src, const Area *src_area, int x, int y);
+
+/*
+ * malloc a transparent image of width x height pixels
+ * return NULL if memory allocation failed
+ */
+Image* create_image(int width, int height);
+
+/*
+ * free an image created by create_image
+ */
+void destroy_image(Image *image);
+
+/*
+ * set every pixel of dest to color
+ * nothing is drawn outside clip, or outside dest if clip is NULL
+ */
+void fill_image(Image *dest, const Area *clip, uint32_t color);
+
+/*
+ * multiply the red, green and blue components of every pixel of dest by the ones of color,
+ * like SDL_BLENDMODE_MOD
+ * nothing is drawn outside clip, or outside dest if clip is NULL
+ */
+void modulate_image(Image *dest, const Area *clip, uint32_t color);
+
+#endif
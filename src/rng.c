@@ -0,0 +1,86 @@
+
+/*
+ * rng.c
+ *
+ * Copyright 2012 Bresson Matthieu <mbresson@etudiant.univ-mlv.fr>
+ *
+ * This file is part of Blockmatic.
+ *
+ * Blockmatic is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Blockmatic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULIAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Blockmatic. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "rng.h"
+
+#include "debug.h"
+
+#include <stddef.h>
+
+
+static inline uint64_t rotate_left(uint64_t value, int shift) {
+	return (value << shift) | (value >> (64 - shift));
+}
+
+
+uint64_t next_random(Rng *rng) {
+	assert(rng != NULL);
+
+	uint64_t *s = rng->s;
+
+	uint64_t result = rotate_left(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+
+	s[2] ^= t;
+	s[3] = rotate_left(s[3], 45);
+
+	return result;
+}
+
+
+/*
+ * the 32 high bits are scaled to the range with a multiplication,
+ * which is faster than a modulo and barely biased for such small ranges
+ */
+int random_in_range(Rng *rng, int min, int max) {
+	assert(rng != NULL);
+	assert(min < max);
+
+	uint64_t range = (uint64_t) (max - min);
+
+	return min + (int) (((next_random(rng) >> 32) * range) >> 32);
+}
+
+
+/*
+ * the seed is expanded with splitmix64, as advised by the authors of xoshiro
+ * this way, the state is never all zeros
+ */
+void seed_rng(Rng *rng, uint64_t seed) {
+	assert(rng != NULL);
+
+	for(int index = 0; index < 4; index++) {
+		seed += 0x9e3779b97f4a7c15;
+
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+		rng->s[index] = z ^ (z >> 31);
+	}
+}
@@ -0,0 +1,32 @@
+
+#ifndef H_RNG
+#define H_RNG
+
+#include <stdint.h>
+
+/*
+ * the state of a xoshiro256** pseudo-random number generator
+ * each game owns one, so sequences can be reproduced from a seed
+ * and several games never share any state
+ */
+typedef struct {
+	uint64_t s[4];
+} Rng;
+
+/*
+ * return the next 64 random bits
+ */
+uint64_t next_random(Rng *rng);
+
+/*
+ * return a random number such as min <= result < max
+ */
+int random_in_range(Rng *rng, int min, int max);
+
+/*
+ * initialize rng from a single number
+ * the same seed always gives the same sequence
+ */
+void seed_rng(Rng *rng, uint64_t seed);
+
+#endif
@@ -23,448 +23,214 @@
 
 #include "tetri.h"
 
-#include "engine.h"
+#include "grid.h"
 #include "param.h"
 #include "debug.h"
 
-#include <stdlib.h>
+#include <stddef.h>
 
 
-// min <= result < max
-static inline int get_random_in_range(int min, int max) {
-	assert(min < max);
-
-	return (rand() % max + min);
-}
+/*
+ * here, we hard-code the coordinates of each block in a tetri
+ * theses coordinates are relative to the pivot block of each tetri
+ * this pivot block is marked X, the other blocks are marked O
+ *
+ * each entry is: x, y, py, mask, mask_x, mask_y, width, height (see Shape in tetri.h)
+ */
+static const Shape s_shapes[__LAST_FORMAT][__LAST_ORIENTED] = {
+	[I_FORMAT] = {
+		/*
+			O
+			X
+			O
+			O
+		*/
+		[TOP_ORIENTED] = {{0, 0, 0, 0}, {-1, 0, 1, 2}, 1, {0x1, 0x1, 0x1, 0x1}, 0, -1, 1, 4},
 
+		/*
+			OXOO
+		*/
+		[LEFT_ORIENTED] = {{-1, 0, 1, 2}, {0, 0, 0, 0}, 0, {0xf, 0x0, 0x0, 0x0}, -1, 0, 4, 1},
 
-// long, painful function!
-static void place_tetri(Tetri *tetri, const Settings *settings) {
-	assert(tetri != NULL);
-	assert(settings != NULL);
+		/*
+			O
+			O
+			X
+			O
+		*/
+		[BOTTOM_ORIENTED] = {{0, 0, 0, 0}, {-2, -1, 0, 1}, 2, {0x1, 0x1, 0x1, 0x1}, 0, -2, 1, 4},
 
-	tetri->px = settings->blocks_per_row / 2;
+		/*
+			OOXO
+		*/
+		[RIGHT_ORIENTED] = {{-2, -1, 0, 1}, {0, 0, 0, 0}, 0, {0xf, 0x0, 0x0, 0x0}, -2, 0, 4, 1},
+	},
 
-	/*
-	 * here, we hard-code the coordinates of each block in a tetri
-	 * theses coordinates are relative to the pivot block of each tetri
-	 * this pivot block is marked X, the other blocks are marked O
-	 */
-	
-	switch(tetri->type) {
-	case I_FORMAT:
-		switch(tetri->orientation) {
-		case TOP_ORIENTED:
-			/*
-				O
-				X
-				O
-				O
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 1;
-			tetri->x[3] = 0; tetri->y[3] = 2;
-
-			tetri->py = 1;
-			break;
-
-		case LEFT_ORIENTED:
-			/*
-				OXOO
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = 0;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 1; tetri->y[2] = 0;
-			tetri->x[3] = 2; tetri->y[3] = 0;
-
-			tetri->py = 0;
-			break;
-
-		case BOTTOM_ORIENTED:
-			/*
-				O
-				O
-				X
-				O
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -2;
-			tetri->x[1] = 0; tetri->y[1] = -1;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 2;
-			break;
-
-		case RIGHT_ORIENTED:
-			/*
-				OOXO
-			*/
-
-			tetri->x[0] = -2; tetri->y[0] = 0;
-			tetri->x[1] = -1; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 1; tetri->y[3] = 0;
-
-			tetri->py = 0;
-
-			break;
-
-		default:
-			assert(tetri->orientation != __LAST_ORIENTED); // WILL FAIL!
-		}
-		break;
-	
-	case O_FORMAT:
+	[O_FORMAT] = {
 		/*
 			OX
 			OO
 		*/
 
 		// no rotation
-		tetri->x[0] = -1; tetri->y[0] = 0;
-		tetri->x[1] = 0; tetri->y[1] = 0;
-		tetri->x[2] = -1; tetri->y[2] = 1;
-		tetri->x[3] = 0; tetri->y[3] = 1;
+		[TOP_ORIENTED] = {{-1, 0, -1, 0}, {0, 0, 1, 1}, 0, {0x3, 0x3, 0x0, 0x0}, -1, 0, 2, 2},
+		[LEFT_ORIENTED] = {{-1, 0, -1, 0}, {0, 0, 1, 1}, 0, {0x3, 0x3, 0x0, 0x0}, -1, 0, 2, 2},
+		[BOTTOM_ORIENTED] = {{-1, 0, -1, 0}, {0, 0, 1, 1}, 0, {0x3, 0x3, 0x0, 0x0}, -1, 0, 2, 2},
+		[RIGHT_ORIENTED] = {{-1, 0, -1, 0}, {0, 0, 1, 1}, 0, {0x3, 0x3, 0x0, 0x0}, -1, 0, 2, 2},
+	},
 
-		tetri->py = 0;
-		break;
-	
-	case T_FORMAT:
-		switch(tetri->orientation) {
-		case TOP_ORIENTED:
-			/*
-				 O
-				OXO
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = -1; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 1; tetri->y[3] = 0;
-
-			tetri->py = 1;
-			break;
-
-		case LEFT_ORIENTED:
-			/*
-				 O
-				OX
-				 O
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = -1; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case BOTTOM_ORIENTED:
-			/*
-				OXO
-				 O
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = 0;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 1; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 0;
-			break;
-
-		case RIGHT_ORIENTED:
-			/*
-				O
-				XO
-				O
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 1; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		default:
-			assert(tetri->orientation != __LAST_ORIENTED); // WILL FAIL!
-		}
-		break;
-	
-	case J_FORMAT:
-		switch(tetri->orientation) {
-		case TOP_ORIENTED:
-			/*
-				OO
-				X
-				O
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = 1; tetri->y[1] = -1;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case LEFT_ORIENTED:
-			/*
-				O
-				OXO
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = -1;
-			tetri->x[1] = -1; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 1; tetri->y[3] = 0;
-
-			tetri->py = 1;
-			break;
-
-		case BOTTOM_ORIENTED:
-			/*
-				 O
-				 X
-				OO
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = -1; tetri->y[2] = 1;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case RIGHT_ORIENTED:
-			/*
-				OXO
-				  O
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = 0;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 1; tetri->y[2] = 0;
-			tetri->x[3] = 1; tetri->y[3] = 1;
-
-			tetri->py = 0;
-			break;
-
-		default:
-			assert(tetri->orientation != __LAST_ORIENTED); // WILL FAIL!
-		}
-		break;
-	
-	case L_FORMAT:
-		switch(tetri->orientation) {
-		case TOP_ORIENTED:
-			/*
-				OO
-				 X
-				 O
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = -1;
-			tetri->x[1] = 0; tetri->y[1] = -1;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case LEFT_ORIENTED:
-			/*
-				OXO
-				O
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = 0;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 1; tetri->y[2] = 0;
-			tetri->x[3] = -1; tetri->y[3] = 1;
-
-			tetri->py = 0;
-			break;
-
-		case BOTTOM_ORIENTED:
-			/*
-				O
-				X
-				OO
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 1;
-			tetri->x[3] = 1; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case RIGHT_ORIENTED:
-			/*
-				  O
-				OXO
-			*/
-
-			tetri->x[0] = 1; tetri->y[0] = -1;
-			tetri->x[1] = -1; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 1; tetri->y[3] = 0;
-
-			tetri->py = 1;
-			break;
-
-		default:
-			assert(tetri->orientation != __LAST_ORIENTED); // WILL FAIL!
-		}
-		break;
-	
-	case S_FORMAT:
-		switch(tetri->orientation) {
-		case TOP_ORIENTED:
-			/*
-				O
-				XO
-				 O
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 1; tetri->y[2] = 0;
-			tetri->x[3] = 1; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case LEFT_ORIENTED:
-			/*
-				 OO
-				OX
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = 1; tetri->y[1] = -1;
-			tetri->x[2] = -1; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 0;
-
-			tetri->py = 1;
-			break;
-
-		case BOTTOM_ORIENTED:
-			/*
-				O
-				OX
-				 O
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = -1;
-			tetri->x[1] = -1; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case RIGHT_ORIENTED:
-			/*
-				 XO
-				OO
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = 0;
-			tetri->x[1] = 1; tetri->y[1] = 0;
-			tetri->x[2] = -1; tetri->y[2] = 1;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 0;
-			break;
-
-		default:
-			assert(tetri->orientation != __LAST_ORIENTED); // WILL FAIL!
-		}
-		break;
-	
-	case Z_FORMAT:
-		switch(tetri->orientation) {
-		case TOP_ORIENTED:
-			/*
-				 O
-				OX
-				O
-			*/
-
-			tetri->x[0] = 0; tetri->y[0] = -1;
-			tetri->x[1] = -1; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = -1; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case LEFT_ORIENTED:
-			/*
-				OX
-				 OO
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = 0;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 0; tetri->y[2] = 1;
-			tetri->x[3] = 1; tetri->y[3] = 1;
-
-			tetri->py = 0;
-			break;
-
-		case BOTTOM_ORIENTED:
-			/*
-				 O
-				XO
-				O
-			*/
-
-			tetri->x[0] = 1; tetri->y[0] = -1;
-			tetri->x[1] = 0; tetri->y[1] = 0;
-			tetri->x[2] = 1; tetri->y[2] = 0;
-			tetri->x[3] = 0; tetri->y[3] = 1;
-
-			tetri->py = 1;
-			break;
-
-		case RIGHT_ORIENTED:
-			/*
-				OO
-				 XO
-			*/
-
-			tetri->x[0] = -1; tetri->y[0] = -1;
-			tetri->x[1] = 0; tetri->y[1] = -1;
-			tetri->x[2] = 0; tetri->y[2] = 0;
-			tetri->x[3] = 1; tetri->y[3] = 0;
-
-			tetri->py = 1;
-			break;
-
-		default:
-			assert(tetri->orientation != __LAST_ORIENTED); // WILL FAIL!
-		}
-		break;
-	
-	default:
-		assert(tetri->type != __LAST_FORMAT); // WILL FAIL
-	}
+	[T_FORMAT] = {
+		/*
+			 O
+			OXO
+		*/
+		[TOP_ORIENTED] = {{0, -1, 0, 1}, {-1, 0, 0, 0}, 1, {0x2, 0x7, 0x0, 0x0}, -1, -1, 3, 2},
+
+		/*
+			 O
+			OX
+			 O
+		*/
+		[LEFT_ORIENTED] = {{0, -1, 0, 0}, {-1, 0, 0, 1}, 1, {0x2, 0x3, 0x2, 0x0}, -1, -1, 2, 3},
+
+		/*
+			OXO
+			 O
+		*/
+		[BOTTOM_ORIENTED] = {{-1, 0, 1, 0}, {0, 0, 0, 1}, 0, {0x7, 0x2, 0x0, 0x0}, -1, 0, 3, 2},
+
+		/*
+			O
+			XO
+			O
+		*/
+		[RIGHT_ORIENTED] = {{0, 0, 1, 0}, {-1, 0, 0, 1}, 1, {0x1, 0x3, 0x1, 0x0}, 0, -1, 2, 3},
+	},
+
+	[J_FORMAT] = {
+		/*
+			OO
+			X
+			O
+		*/
+		[TOP_ORIENTED] = {{0, 1, 0, 0}, {-1, -1, 0, 1}, 1, {0x3, 0x1, 0x1, 0x0}, 0, -1, 2, 3},
+
+		/*
+			O
+			OXO
+		*/
+		[LEFT_ORIENTED] = {{-1, -1, 0, 1}, {-1, 0, 0, 0}, 1, {0x1, 0x7, 0x0, 0x0}, -1, -1, 3, 2},
+
+		/*
+			 O
+			 X
+			OO
+		*/
+		[BOTTOM_ORIENTED] = {{0, 0, -1, 0}, {-1, 0, 1, 1}, 1, {0x2, 0x2, 0x3, 0x0}, -1, -1, 2, 3},
+
+		/*
+			OXO
+			  O
+		*/
+		[RIGHT_ORIENTED] = {{-1, 0, 1, 1}, {0, 0, 0, 1}, 0, {0x7, 0x4, 0x0, 0x0}, -1, 0, 3, 2},
+	},
+
+	[L_FORMAT] = {
+		/*
+			OO
+			 X
+			 O
+		*/
+		[TOP_ORIENTED] = {{-1, 0, 0, 0}, {-1, -1, 0, 1}, 1, {0x3, 0x2, 0x2, 0x0}, -1, -1, 2, 3},
+
+		/*
+			OXO
+			O
+		*/
+		[LEFT_ORIENTED] = {{-1, 0, 1, -1}, {0, 0, 0, 1}, 0, {0x7, 0x1, 0x0, 0x0}, -1, 0, 3, 2},
+
+		/*
+			O
+			X
+			OO
+		*/
+		[BOTTOM_ORIENTED] = {{0, 0, 0, 1}, {-1, 0, 1, 1}, 1, {0x1, 0x1, 0x3, 0x0}, 0, -1, 2, 3},
+
+		/*
+			  O
+			OXO
+		*/
+		[RIGHT_ORIENTED] = {{1, -1, 0, 1}, {-1, 0, 0, 0}, 1, {0x4, 0x7, 0x0, 0x0}, -1, -1, 3, 2},
+	},
+
+	[S_FORMAT] = {
+		/*
+			O
+			XO
+			 O
+		*/
+		[TOP_ORIENTED] = {{0, 0, 1, 1}, {-1, 0, 0, 1}, 1, {0x1, 0x3, 0x2, 0x0}, 0, -1, 2, 3},
+
+		/*
+			 OO
+			OX
+		*/
+		[LEFT_ORIENTED] = {{0, 1, -1, 0}, {-1, -1, 0, 0}, 1, {0x6, 0x3, 0x0, 0x0}, -1, -1, 3, 2},
+
+		/*
+			O
+			OX
+			 O
+		*/
+		[BOTTOM_ORIENTED] = {{-1, -1, 0, 0}, {-1, 0, 0, 1}, 1, {0x1, 0x3, 0x2, 0x0}, -1, -1, 2, 3},
+
+		/*
+			 XO
+			OO
+		*/
+		[RIGHT_ORIENTED] = {{0, 1, -1, 0}, {0, 0, 1, 1}, 0, {0x6, 0x3, 0x0, 0x0}, -1, 0, 3, 2},
+	},
+
+	[Z_FORMAT] = {
+		/*
+			 O
+			OX
+			O
+		*/
+		[TOP_ORIENTED] = {{0, -1, 0, -1}, {-1, 0, 0, 1}, 1, {0x2, 0x3, 0x1, 0x0}, -1, -1, 2, 3},
+
+		/*
+			OX
+			 OO
+		*/
+		[LEFT_ORIENTED] = {{-1, 0, 0, 1}, {0, 0, 1, 1}, 0, {0x3, 0x6, 0x0, 0x0}, -1, 0, 3, 2},
+
+		/*
+			 O
+			XO
+			O
+		*/
+		[BOTTOM_ORIENTED] = {{1, 0, 1, 0}, {-1, 0, 0, 1}, 1, {0x2, 0x3, 0x1, 0x0}, 0, -1, 2, 3},
+
+		/*
+			OO
+			 XO
+		*/
+		[RIGHT_ORIENTED] = {{-1, 0, 0, 1}, {-1, -1, 0, 0}, 1, {0x3, 0x6, 0x0, 0x0}, -1, -1, 3, 2},
+	},
+};
+
+
+const Shape* get_shape(Format type, Orientation orientation) {
+	assert(type >= I_FORMAT && type < __LAST_FORMAT);
+	assert(orientation >= TOP_ORIENTED && orientation < __LAST_ORIENTED);
+
+	return &s_shapes[type][orientation];
 }
 
 
-bool move_tetri(Tetri *tetri, Move mode) {
+bool move_tetri(const Grid *grid, Tetri *tetri, Move mode) {
+	assert(grid != NULL);
 	assert(tetri != NULL);
 
 	Tetri copy = *tetri;
@@ -483,7 +249,7 @@ bool move_tetri(Tetri *tetri, Move mode) {
 		break;
 	}
 
-	if(valid_position(&copy)) {
+	if(valid_position(grid, &copy)) {
 		*tetri = copy;
 	} else if(mode == DOWN_MOVE) {
 		return false;
@@ -493,25 +259,77 @@ bool move_tetri(Tetri *tetri, Move mode) {
 }
 
 
-Tetri new_random_tetri(const Settings *settings) {
+void init_randomizer(Randomizer *randomizer, RandomizerType type, uint64_t seed) {
+	assert(randomizer != NULL);
+	assert(type > UNDEF_RANDOMIZER && type < __LAST_RANDOMIZER);
+
+	randomizer->type = type;
+
+	seed_rng(&(randomizer->orientations), seed);
+	seed_rng(&(randomizer->formats), next_random(&(randomizer->orientations)));
+
+	randomizer->bag_size = 0;
+}
+
+
+Format next_format(Randomizer *randomizer) {
+	assert(randomizer != NULL);
+
+	if(randomizer->type == UNIFORM_RANDOMIZER) {
+		return (Format) random_in_range(&(randomizer->formats), I_FORMAT, __LAST_FORMAT);
+	}
+
+	// BAG_RANDOMIZER: refill the bag, then deal its formats in a random order
+	if(randomizer->bag_size == 0) {
+		for(int format = I_FORMAT; format < __LAST_FORMAT; format++) {
+			randomizer->bag[format] = (Format) format;
+		}
+
+		randomizer->bag_size = __LAST_FORMAT;
+	}
+
+	int index = random_in_range(&(randomizer->formats), 0, randomizer->bag_size);
+	Format format = randomizer->bag[index];
+
+	randomizer->bag_size--;
+	randomizer->bag[index] = randomizer->bag[randomizer->bag_size];
+
+	return format;
+}
+
+
+void next_formats(Randomizer *randomizer, Format *formats, int count) {
+	assert(randomizer != NULL);
+	assert(formats != NULL);
+	assert(count >= 0);
+
+	for(int index = 0; index < count; index++) {
+		formats[index] = next_format(randomizer);
+	}
+}
+
+
+Tetri new_random_tetri(Randomizer *randomizer, const Settings *settings) {
+	assert(randomizer != NULL);
 	assert(settings != NULL);
 	assert(settings->blocks_per_row > 0);
 
 	Tetri tmp;
 
-	tmp.type = get_random_in_range(I_FORMAT, __LAST_FORMAT);
-	tmp.orientation = get_random_in_range(TOP_ORIENTED, __LAST_ORIENTED);
-	tmp.px = settings->blocks_per_row / 2;
+	tmp.type = next_format(randomizer);
+	tmp.orientation = (Orientation) random_in_range(&(randomizer->orientations), TOP_ORIENTED, __LAST_ORIENTED);
+	tmp.shape = &s_shapes[tmp.type][tmp.orientation];
 
-	place_tetri(&tmp, settings);
+	tmp.px = settings->blocks_per_row / 2;
+	tmp.py = tmp.shape->py;
 
 	return tmp;
 }
 
 
-void rotate_tetri(Tetri *tetri, Rotation mode, const Settings *settings) {
+void rotate_tetri(const Grid *grid, Tetri *tetri, Rotation mode) {
+	assert(grid != NULL);
 	assert(tetri != NULL);
-	assert(settings != NULL);
 
 	Tetri copy = *tetri;
 	if(mode == CLOCKWISE_ROTATION) {
@@ -528,12 +346,9 @@ void rotate_tetri(Tetri *tetri, Rotation mode, const Settings *settings) {
 		}
 	}
 
-	place_tetri(&copy, settings);
-
-	copy.px = tetri->px;
-	copy.py = tetri->py;
+	copy.shape = &s_shapes[copy.type][copy.orientation];
 
-	if(valid_position(&copy)) {
+	if(valid_position(grid, &copy)) {
 		*tetri = copy;
 	}
 }
@@ -3,6 +3,7 @@
 #define H_TETRI
 
 #include "param.h"
+#include "rng.h"
 
 typedef enum {
 	/*
@@ -68,15 +69,33 @@ typedef enum {
 	__LAST_ORIENTED
 } Orientation;
 
+/*
+ * the geometry of a tetri in a given orientation
+ * shapes are stored in a constant table, see tetri.c
+ */
+typedef struct {
+	int x[4], y[4]; // coordinates of each block relative to the pivot block
+
+	int py; // the row of the pivot block when the tetri appears at the top of the grid
+
+	/*
+	 * the same shape stored as one bitmask per row
+	 * bit 0 of each mask is the leftmost column of the tetri,
+	 * mask_x and mask_y are the coordinates of this corner relative to the pivot block
+	 */
+	unsigned int mask[4];
+	int mask_x, mask_y;
+	int width, height; // in blocks, only mask[0] to mask[height - 1] are meaningful
+} Shape;
+
 typedef struct {
 	Format type;
 
 	Orientation orientation;
 
-	int px, py; // coordinates of the pivot block (X)
+	const Shape *shape; // depends on type and orientation
 
-	int x[4], y[4]; // coordinates of each block relative to the pivot block,
-	// x[0] and y[0] is the pivot block
+	int px, py; // coordinates of the pivot block (X)
 
 	/*
 	 * when speaking of coordinates,
@@ -95,23 +114,66 @@ typedef enum {
 	DOWN_MOVE
 } Move;
 
+/*
+ * the state of the tetrimino generator of a game
+ * it is a plain value: a copy can be used to foresee the next tetriminos
+ */
+typedef struct {
+	RandomizerType type;
+
+	/*
+	 * formats and orientations come from two different generators,
+	 * so that next_formats yields the formats new_random_tetri will use
+	 */
+	Rng formats, orientations;
+
+	Format bag[__LAST_FORMAT]; // for BAG_RANDOMIZER, the formats not dealt yet
+	int bag_size;
+} Randomizer;
+
+/*
+ * defined in grid.h
+ */
+struct Grid;
+
 /*
  * move tetri to the left or to the right
  * if movement is impossible and move == DOWN_MOVE, return false
  * else return true
  */
-bool move_tetri(Tetri *tetri, Move mode);
+bool move_tetri(const struct Grid *grid, Tetri *tetri, Move mode);
+
+/*
+ * return the geometry of a tetri of the given type and orientation
+ */
+const Shape* get_shape(Format type, Orientation orientation);
+
+/*
+ * set up randomizer to deal tetriminos of the given type
+ * the same seed always gives the same sequence
+ */
+void init_randomizer(Randomizer *randomizer, RandomizerType type, uint64_t seed);
+
+/*
+ * return the next format dealt by randomizer
+ */
+Format next_format(Randomizer *randomizer);
+
+/*
+ * store the next count formats dealt by randomizer in formats
+ */
+void next_formats(Randomizer *randomizer, Format *formats, int count);
 
 /*
  * return a new Tetri object
- * type and orientation are random values
+ * type and orientation are random values taken from randomizer
  */
-Tetri new_random_tetri(const Settings *settings);
+Tetri new_random_tetri(Randomizer *randomizer, const Settings *settings);
 
 /*
- * rotate a shape clockwise/counter-clockwise
- * doesn't perform any check
+ * rotate a shape clockwise/counter-clockwise around its pivot block
+ * if the rotated tetri doesn't fit in grid, tetri is left unchanged
  */
-void rotate_tetri(Tetri *tetri, Rotation mode, const Settings *settings);
+void rotate_tetri(const struct Grid *grid, Tetri *tetri, Rotation mode);
 
 #endif